@@ -5,49 +5,291 @@
 #include <stddef.h>
 #include <assert.h>
 #include <string.h>
+#include <sched.h>
 #include "memory_manager.h"
 #include "linked_list.h"
 
-pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+// State of one list. Lists are told apart by the address of their head pointer, list_insert_after
+// only gets a node and finds its list through Node.list.
+typedef struct {
+    uint64_t writes_started __attribute__((aligned(64))); // See list_write_begin
+    uint64_t writes_finished __attribute__((aligned(64)));
+    Node** head;
+    pthread_mutex_t lock;  // Guards *head and tail, taken through mem_lock_acquire so mem_lock_profile sees it
+    Node* tail;            // Last node, or a node shortly before it. See list_append.
+    uint8_t index;         // Slot in lists, stored in every node
+    mem_pool_t* pool;      // The list's own bump pool, the default pool stays free for the application
+    mem_slab_t* node_slab; // Nodes come from a lock-free slab spanning the list's pool
+    mem_ebr_t* reclaimer;  // Deleted nodes go back to the slab once no reader can still be on them
+} List;
+
+#define LIST_MAX 256 // Live lists, Node.list is a single byte
+
+static List* lists[LIST_MAX];
+static int list_slots = 0; // Slots of lists ever used, lookups stop there
+static pthread_mutex_t lists_lock = PTHREAD_MUTEX_INITIALIZER; // Guards list_init and list_cleanup
+
+// NULL if head was not set up by list_init
+static List* list_of(Node** head) {
+    int slots = __atomic_load_n(&list_slots, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < slots; i++) {
+        List* list = __atomic_load_n(&lists[i], __ATOMIC_ACQUIRE);
+        if (list != NULL && list->head == head) {
+            return list;
+        }
+    }
+    return NULL;
+}
+
+// Readers traverse the list without locks and validate afterwards that no writer changed a link
+// in the meantime. Writers bracket every store to *head or a next pointer with list_write_begin
+// and list_write_end, which are two counters because writers to different nodes run concurrently.
+// Readers walk inside a critical section of the list's reclaimer, so a node deleted under them is
+// not reused before they are done, they only see stale links and retry.
+#define LIST_READ_ATTEMPTS 4 // Optimistic traversals before a reader falls back to lock coupling
+
+static void list_write_begin(List* list) {
+    __atomic_fetch_add(&list->writes_started, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void list_write_end(List* list) {
+    __atomic_fetch_add(&list->writes_finished, 1, __ATOMIC_RELEASE);
+}
+
+static void link_store(List* list, Node** link, Node* node) {
+    list_write_begin(list);
+    __atomic_store_n(link, node, __ATOMIC_RELAXED);
+    list_write_end(list);
+}
+
+// Returns false while a write is in progress, the snapshot is passed to list_read_valid
+static bool list_read_begin(List* list, uint64_t* snapshot) {
+    uint64_t finished = __atomic_load_n(&list->writes_finished, __ATOMIC_ACQUIRE);
+    *snapshot = __atomic_load_n(&list->writes_started, __ATOMIC_RELAXED);
+    return *snapshot == finished;
+}
+
+static bool list_read_valid(List* list, uint64_t snapshot) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&list->writes_started, __ATOMIC_RELAXED) == snapshot;
+}
+
+static Node* link_load(Node** link) {
+    return __atomic_load_n(link, __ATOMIC_RELAXED);
+}
+
+// Node locks are a single byte, taken by test-and-test-and-set. A waiter spins briefly and then
+// yields the CPU, the tests often run many more threads than there are cores.
+#define NODE_LOCK_SPINS 64
+
+static void node_lock(Node* node) {
+    while (__atomic_exchange_n(&node->lock, 1, __ATOMIC_ACQUIRE)) {
+        for (int spins = 0; __atomic_load_n(&node->lock, __ATOMIC_RELAXED); spins++) {
+            if (spins >= NODE_LOCK_SPINS) {
+                sched_yield();
+            }
+        }
+    }
+}
+
+static void node_unlock(Node* node) {
+    __atomic_store_n(&node->lock, 0, __ATOMIC_RELEASE);
+}
 
+// The pool can grow past the size given to list_init: deleted nodes are reclaimed in batches,
+// so a full list may briefly need more nodes than it holds
+#define RECLAIM_HEADROOM (1 << 16)
+
+// Falls back to the general allocator if the slab is empty, after giving the reclaimer a chance
+// to return deleted nodes. Nodes allocated past the slab stay in the pool until list_cleanup.
+static Node* node_alloc(List* list) {
+    Node* node = NULL;
+    if (list->node_slab) {
+        node = (Node*)mem_slab_alloc(list->node_slab);
+        if (node == NULL) {
+            mem_ebr_flush(list->reclaimer);
+            node = (Node*)mem_slab_alloc(list->node_slab);
+        }
+    }
+    if (node == NULL) {
+        node = (Node*)mem_pool_alloc_uninit(list->pool, sizeof(Node)); // The other fields are set by the caller
+    }
+    if (node != NULL) {
+        node->list = list->index;
+    }
+    return node;
+}
+
+// Returns how many of count nodes were allocated
+static size_t node_alloc_bulk(List* list, Node** nodes, size_t count) {
+    size_t n = 0;
+    while (n < count && list->node_slab && (nodes[n] = (Node*)mem_slab_alloc(list->node_slab)) != NULL) {
+        n++;
+    }
+    n += mem_pool_alloc_bulk(list->pool, sizeof(Node), count - n, (void**)nodes + n);
+    for (size_t i = 0; i < n; i++) {
+        nodes[i]->list = list->index;
+    }
+    return n;
+}
+
+static void list_destroy(List* list) {
+    mem_ebr_destroy(list->reclaimer);
+    mem_slab_destroy(list->node_slab);
+    mem_pool_destroy(list->pool);
+    pthread_mutex_destroy(&list->lock);
+    free(list);
+}
+
+// Takes a free slot of lists, a list set up again on the same head first loses its old state
 void list_init(Node** head, size_t size) {
-    //pthread_mutex_lock(&global_lock);
-    mem_init(size);
+    List* list;
+    if (posix_memalign((void**)&list, 64, sizeof(List)) != 0) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    memset(list, 0, sizeof(List));
+    list->head = head;
+    pthread_mutex_init(&list->lock, NULL);
+    list->pool = mem_pool_create_config(size, (mem_config_t){.engine = MEM_ENGINE_BUMP, .max_size = 2 * size + RECLAIM_HEADROOM});
+    list->node_slab = mem_pool_slab_create(list->pool, sizeof(Node), size / sizeof(Node));
+    list->reclaimer = list->node_slab ? mem_slab_ebr_create(list->node_slab) : mem_pool_ebr_create(list->pool);
+
+    pthread_mutex_lock(&lists_lock);
+    List* old = list_of(head);
+    int slot = old ? old->index : 0;
+    while (old == NULL && slot < LIST_MAX && lists[slot] != NULL) {
+        slot++;
+    }
+    if (slot == LIST_MAX) {
+        pthread_mutex_unlock(&lists_lock);
+        fprintf(stderr, "Too many lists\n");
+        exit(EXIT_FAILURE);
+    }
+    list->index = slot;
+    __atomic_store_n(&lists[slot], list, __ATOMIC_RELEASE);
+    if (slot == list_slots) {
+        __atomic_store_n(&list_slots, slot + 1, __ATOMIC_RELEASE);
+    }
     *head = NULL;
-    //pthread_mutex_unlock(&global_lock);
+    pthread_mutex_unlock(&lists_lock);
+    if (old) {
+        list_destroy(old);
+    }
+}
+
+// Writers need the list's pool, a head that list_init has not set up can't take nodes
+static List* list_for_write(Node** head) {
+    List* list = list_of(head);
+    if (list == NULL) {
+        fprintf(stderr, "List not initialized\n");
+    }
+    return list;
+}
+
+// Links the chain first .. last behind the last node. The tail is claimed under list->lock and
+// its node locked before list->lock is released, so concurrent appenders queue up behind each
+// other's new nodes instead of walking the list. list_insert_after may have added nodes behind
+// the claimed tail, those few are walked with lock coupling.
+static void list_append(List* list, Node* first, Node* last) {
+    mem_lock_acquire(&list->lock, MEM_LOCK_LIST_INSERT);
+    Node* temp = list->tail;
+    list->tail = last;
+    if (temp == NULL) {
+        link_store(list, list->head, first);
+        mem_lock_release(&list->lock, MEM_LOCK_LIST_INSERT);
+        return;
+    }
+    node_lock(temp);
+    mem_lock_release(&list->lock, MEM_LOCK_LIST_INSERT);
+
+    while (temp->next != NULL) {
+        Node* next = temp->next;
+        node_lock(next);
+        node_unlock(temp);
+        temp = next;
+    }
+    link_store(list, &temp->next, first);
+    node_unlock(temp);
 }
 
 void list_insert(Node** head, uint16_t data) {
+    List* list = list_for_write(head);
+    if (list == NULL) {
+        return;
+    }
+    Node* new_node = node_alloc(list);
+    if (new_node == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    new_node->lock = 0;
+    new_node->data = data;
+    new_node->next = NULL;
 
-    Node* new_node = (Node*)mem_alloc(sizeof(Node));
+    list_append(list, new_node, new_node);
+}
+
+// Appends by lock coupling from the head, the way list_insert did before it kept a tail.
+// Only kept to benchmark list_insert against.
+void list_insert_walk(Node** head, uint16_t data) {
+    List* list = list_for_write(head);
+    if (list == NULL) {
+        return;
+    }
+    Node* new_node = node_alloc(list);
     if (new_node == NULL) {
         fprintf(stderr, "Memory allocation failed\n");
         exit(EXIT_FAILURE);
     }
-    pthread_mutex_init(&new_node->lock, NULL);
+    new_node->lock = 0;
     new_node->data = data;
     new_node->next = NULL;
-    
 
-    pthread_mutex_lock(&global_lock);
+    mem_lock_acquire(&list->lock, MEM_LOCK_LIST_INSERT);
     if (*head == NULL) {
-        *head = new_node; 
-        pthread_mutex_unlock(&global_lock);
-    } else {
-        Node* temp = *head;
-        pthread_mutex_lock(&temp->lock);
-        pthread_mutex_unlock(&global_lock);
-        
-        while (temp->next != NULL) {
-            Node* next = temp->next;
-            pthread_mutex_lock(&next->lock);
-            pthread_mutex_unlock(&temp->lock);
-            temp = next;
-        }
-        temp->next = new_node;
-        pthread_mutex_unlock(&temp->lock);
-        
+        list->tail = new_node;
+        link_store(list, head, new_node);
+        mem_lock_release(&list->lock, MEM_LOCK_LIST_INSERT);
+        return;
+    }
+    Node* temp = *head;
+    node_lock(temp);
+    mem_lock_release(&list->lock, MEM_LOCK_LIST_INSERT);
+
+    while (temp->next != NULL) {
+        Node* next = temp->next;
+        node_lock(next);
+        node_unlock(temp);
+        temp = next;
     }
+    link_store(list, &temp->next, new_node); // The tail now trails the end, list_append catches up
+    node_unlock(temp);
+}
+
+// Appends count values in order. The nodes are allocated and chained up front, so the tail
+// is claimed and locked only once.
+void list_insert_bulk(Node** head, const uint16_t* data, size_t count) {
+    List* list = list_for_write(head);
+    if (list == NULL || count == 0) {
+        return;
+    }
+    Node** nodes = malloc(count * sizeof(Node*));
+    if (nodes == NULL || node_alloc_bulk(list, nodes, count) < count) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    for (size_t i = 0; i < count; i++) {
+        nodes[i]->lock = 0;
+        nodes[i]->data = data[i];
+        nodes[i]->next = i + 1 < count ? nodes[i + 1] : NULL;
+    }
+    Node* first = nodes[0];
+    Node* last = nodes[count - 1];
+    free(nodes);
+
+    list_append(list, first, last);
 }
 
 void list_insert_after(Node* prev_node, uint16_t data) {
@@ -56,21 +298,21 @@ void list_insert_after(Node* prev_node, uint16_t data) {
         return;
     }
 
-    pthread_mutex_lock(&prev_node->lock);
+    List* list = lists[prev_node->list];
+    node_lock(prev_node);
 
-    Node* new_node = (Node*)mem_alloc(sizeof(Node));
+    Node* new_node = node_alloc(list);
     if (new_node == NULL) {
         fprintf(stderr, "Memory allocation failed\n");
-        pthread_mutex_unlock(&prev_node->lock);
+        node_unlock(prev_node);
         exit(EXIT_FAILURE);
     }
-    pthread_mutex_init(&new_node->lock, NULL);
+    new_node->lock = 0;
     new_node->data = data;
     new_node->next = prev_node->next;
 
-
-    prev_node->next = new_node;
-    pthread_mutex_unlock(&prev_node->lock);
+    link_store(list, &prev_node->next, new_node);
+    node_unlock(prev_node);
 }
 
 void list_insert_before(Node** head, Node* next_node, uint16_t data) {
@@ -78,70 +320,80 @@ void list_insert_before(Node** head, Node* next_node, uint16_t data) {
         fprintf(stderr, "Next node cannot be NULL\n");
         return;
     }
+    List* list = list_for_write(head);
+    if (list == NULL) {
+        return;
+    }
 
-    pthread_mutex_lock(&global_lock);
+    mem_lock_acquire(&list->lock, MEM_LOCK_LIST_INSERT);
     if (*head == next_node) {
-        Node* new_node = (Node*)mem_alloc(sizeof(Node));
+        Node* new_node = node_alloc(list);
         if (new_node == NULL) {
             fprintf(stderr, "Memory allocation failed\n");
-            pthread_mutex_unlock(&global_lock);
+            mem_lock_release(&list->lock, MEM_LOCK_LIST_INSERT);
             exit(EXIT_FAILURE);
         }
-        pthread_mutex_init(&new_node->lock, NULL);
+        new_node->lock = 0;
         new_node->data = data;
         new_node->next = *head;
-        *head = new_node;
-        pthread_mutex_unlock(&global_lock);
+        link_store(list, head, new_node);
+        mem_lock_release(&list->lock, MEM_LOCK_LIST_INSERT);
         return;
     }
 
     Node* temp = *head;
-    pthread_mutex_lock(&temp->lock);
-    pthread_mutex_unlock(&global_lock);
+    node_lock(temp);
+    mem_lock_release(&list->lock, MEM_LOCK_LIST_INSERT);
 
     while (temp->next != NULL && temp->next != next_node) {
         Node* next = temp->next;
-        pthread_mutex_lock(&next->lock);
-        pthread_mutex_unlock(&temp->lock);
+        node_lock(next);
+        node_unlock(temp);
         temp = next;
     }
 
     if (temp->next == NULL) {
         fprintf(stderr, "Next node not found in the list\n");
-        pthread_mutex_unlock(&temp->lock);
+        node_unlock(temp);
         return;
     }
 
-    Node* new_node = (Node*)mem_alloc(sizeof(Node));
+    Node* new_node = node_alloc(list);
     if (new_node == NULL) {
         fprintf(stderr, "Memory allocation failed\n");
-        pthread_mutex_unlock(&temp->lock);
+        node_unlock(temp);
         exit(EXIT_FAILURE);
     }
-    pthread_mutex_init(&new_node->lock, NULL);
+    new_node->lock = 0;
     new_node->data = data;
     new_node->next = next_node;
 
-    temp->next = new_node;
-    pthread_mutex_unlock(&temp->lock);
+    link_store(list, &temp->next, new_node);
+    node_unlock(temp);
 }
 
 void list_delete(Node** head, uint16_t data) {
-    pthread_mutex_lock(&global_lock);
+    List* list = list_of(head);
+    if (list == NULL) {
+        return;
+    }
+    mem_lock_acquire(&list->lock, MEM_LOCK_LIST_DELETE);
     if (*head == NULL) {
-        pthread_mutex_unlock(&global_lock);
+        mem_lock_release(&list->lock, MEM_LOCK_LIST_DELETE);
         return;
     }
 
     Node* temp = *head;
-    pthread_mutex_lock(&temp->lock);
+    node_lock(temp);
     
     if (temp->data == data) {
-        *head = temp->next;
-        pthread_mutex_unlock(&global_lock);
-        pthread_mutex_unlock(&temp->lock);
-        pthread_mutex_destroy(&temp->lock);
-        mem_free(temp);
+        if (list->tail == temp) {
+            list->tail = temp->next; // NULL once the list is empty
+        }
+        link_store(list, head, temp->next);
+        mem_lock_release(&list->lock, MEM_LOCK_LIST_DELETE);
+        node_unlock(temp);
+        mem_ebr_retire(list->reclaimer, temp);
         return;
     }
 
@@ -149,62 +401,127 @@ void list_delete(Node** head, uint16_t data) {
     temp = temp->next;
 
     while (temp != NULL) {
-        pthread_mutex_lock(&temp->lock);
+        node_lock(temp);
         if (temp->data == data) {
-            prev->next = temp->next;
-            pthread_mutex_unlock(&global_lock);
-            pthread_mutex_unlock(&temp->lock);
-            pthread_mutex_destroy(&temp->lock);
-            mem_free(temp);
-            pthread_mutex_unlock(&prev->lock);
+            if (list->tail == temp) {
+                list->tail = temp->next ? temp->next : prev;
+            }
+            link_store(list, &prev->next, temp->next);
+            mem_lock_release(&list->lock, MEM_LOCK_LIST_DELETE);
+            node_unlock(temp);
+            mem_ebr_retire(list->reclaimer, temp);
+            node_unlock(prev);
             return;
         }
-        pthread_mutex_unlock(&prev->lock);
+        node_unlock(prev);
         prev = temp;
         temp = temp->next;
     }
-    pthread_mutex_unlock(&global_lock);
-    pthread_mutex_unlock(&prev->lock);
+    mem_lock_release(&list->lock, MEM_LOCK_LIST_DELETE);
+    node_unlock(prev);
 }
 
-Node* list_search(Node** head, uint16_t data) {
-    pthread_mutex_lock(&global_lock);
-    if (*head == NULL) {
-        pthread_mutex_unlock(&global_lock);
+// Lock coupling, used when the optimistic traversal keeps being invalidated by writers
+static Node* list_search_locked(List* list, uint16_t data) {
+    mem_lock_acquire(&list->lock, MEM_LOCK_LIST_READ);
+    if (*list->head == NULL) {
+        mem_lock_release(&list->lock, MEM_LOCK_LIST_READ);
         return NULL;
     }
 
-    Node* temp = *head;
-    pthread_mutex_lock(&temp->lock);
-    pthread_mutex_unlock(&global_lock);
+    Node* temp = *list->head;
+    node_lock(temp);
+    mem_lock_release(&list->lock, MEM_LOCK_LIST_READ);
 
     while (temp != NULL) {
         if (temp->data == data) {
-            pthread_mutex_unlock(&temp->lock);
+            node_unlock(temp);
             return temp;
         }
         Node* next = temp->next;
         if (next != NULL) {
-            pthread_mutex_lock(&next->lock);
+            node_lock(next);
         }
-        pthread_mutex_unlock(&temp->lock);
+        node_unlock(temp);
         temp = next;
     }
     return NULL;
 }
 
-void list_display(Node** head) 
+// Walks the list without locks and stops at the first node holding data, or after visit returns
+// false. Returns false if a writer may have changed the list during the walk, in which case
+// nothing it saw can be trusted.
+static bool list_walk(List* list, bool (*visit)(Node* node, uint16_t data, void* arg), void* arg) {
+    uint64_t snapshot;
+    if (!list_read_begin(list, &snapshot)) {
+        return false;
+    }
+    mem_ebr_enter(list->reclaimer);
+    for (Node* current = link_load(list->head); current != NULL; current = link_load(&current->next)) {
+        if (!visit(current, __atomic_load_n(&current->data, __ATOMIC_RELAXED), arg)) {
+            break;
+        }
+    }
+    mem_ebr_exit(list->reclaimer);
+    return list_read_valid(list, snapshot);
+}
+
+typedef struct {
+    uint16_t data;
+    Node* found;
+} SearchWalk;
+
+static bool search_visit(Node* node, uint16_t data, void* arg) {
+    SearchWalk* walk = arg;
+    if (data == walk->data) {
+        walk->found = node;
+        return false;
+    }
+    return true;
+}
+
+// A node deleted after the walk is retired, not freed, so it stays valid as long as the caller's
+// own read section lasts. Without one it can be reused as soon as the walk's section ends.
+Node* list_search(Node** head, uint16_t data) {
+    List* list = list_of(head);
+    if (list == NULL) {
+        return NULL;
+    }
+    for (int attempt = 0; attempt < LIST_READ_ATTEMPTS; attempt++) {
+        SearchWalk walk = {data, NULL};
+        if (list_walk(list, search_visit, &walk)) {
+            return walk.found;
+        }
+    }
+    return list_search_locked(list, data);
+}
+
+void list_read_enter(Node** head) {
+    List* list = list_of(head);
+    if (list != NULL) {
+        mem_ebr_enter(list->reclaimer);
+    }
+}
+
+void list_read_exit(Node** head) {
+    List* list = list_of(head);
+    if (list != NULL) {
+        mem_ebr_exit(list->reclaimer);
+    }
+}
+
+static void list_display_locked(List* list)
 {
-    pthread_mutex_lock(&global_lock);
-    if (head == NULL || *head == NULL) {
+    mem_lock_acquire(&list->lock, MEM_LOCK_LIST_READ);
+    if (*list->head == NULL) {
         printf("[]\n");
-        pthread_mutex_unlock(&global_lock);
+        mem_lock_release(&list->lock, MEM_LOCK_LIST_READ);
         return;
     }
 
-    Node* current = *head;
-    pthread_mutex_lock(&current->lock);
-    pthread_mutex_unlock(&global_lock);
+    Node* current = *list->head;
+    node_lock(current);
+    mem_lock_release(&list->lock, MEM_LOCK_LIST_READ);
 
     char buffer[1024] = "[";
     char temp_str[32];
@@ -216,15 +533,46 @@ void list_display(Node** head)
         Node* next = current->next;
         if (next != NULL) {
             strcat(buffer, ", ");
-            pthread_mutex_lock(&next->lock);
+            node_lock(next);
         }
-        pthread_mutex_unlock(&current->lock);
+        node_unlock(current);
         current = next;
     }
     strcat(buffer, "]");
     printf("%s\n", buffer);
 }
 
+typedef struct {
+    char buffer[1024];
+    size_t length;
+} DisplayWalk;
+
+static bool display_visit(Node* node, uint16_t data, void* arg) {
+    DisplayWalk* walk = arg;
+    if (walk->length < sizeof(walk->buffer)) {
+        walk->length += snprintf(walk->buffer + walk->length, sizeof(walk->buffer) - walk->length,
+                                 walk->length > 1 ? ", %d" : "%d", data);
+    }
+    return true;
+}
+
+void list_display(Node** head)
+{
+    List* list = list_of(head);
+    if (list == NULL) {
+        printf("[]\n");
+        return;
+    }
+    for (int attempt = 0; attempt < LIST_READ_ATTEMPTS; attempt++) {
+        DisplayWalk walk = {"[", 1};
+        if (list_walk(list, display_visit, &walk)) {
+            printf("%s]\n", walk.buffer);
+            return;
+        }
+    }
+    list_display_locked(list);
+}
+
 void list_display_range(Node** head, Node* start_node, Node* end_node) 
 {
     if (head == NULL || *head == NULL) {
@@ -261,48 +609,71 @@ void list_display_range(Node** head, Node* start_node, Node* end_node)
     printf("%s", buffer); // Print the final output string
 }
 
-int list_count_nodes(Node** head) {
+static int list_count_nodes_locked(List* list) {
 
     int count = 0;
 
-    pthread_mutex_lock(&global_lock);
-    if (head == NULL || *head == NULL) {
-        pthread_mutex_unlock(&global_lock);
+    mem_lock_acquire(&list->lock, MEM_LOCK_LIST_READ);
+    if (*list->head == NULL) {
+        mem_lock_release(&list->lock, MEM_LOCK_LIST_READ);
         return count;
     }
 
-    Node* current = *head;
-    pthread_mutex_lock(&current->lock);
-    pthread_mutex_unlock(&global_lock);
+    Node* current = *list->head;
+    node_lock(current);
+    mem_lock_release(&list->lock, MEM_LOCK_LIST_READ);
 
     while (current != NULL) {
         count++;
         Node* next = current->next;
         if (next != NULL) {
-            pthread_mutex_lock(&next->lock);
+            node_lock(next);
         }
-        pthread_mutex_unlock(&current->lock);
+        node_unlock(current);
         current = next;
     }
     return count;
 }
 
-void list_cleanup(Node** head) {
-    pthread_mutex_lock(&global_lock);
-    Node* current = *head;
-    *head = NULL;
-    pthread_mutex_unlock(&global_lock);
+static bool count_visit(Node* node, uint16_t data, void* arg) {
+    (*(int*)arg)++;
+    return true;
+}
 
-    while (current != NULL) {
-        pthread_mutex_lock(&current->lock);
-        Node* next_node = current->next;
-        pthread_mutex_unlock(&current->lock);
-        pthread_mutex_destroy(&current->lock);
-        mem_free(current);
-        current = next_node;
+int list_count_nodes(Node** head) {
+    List* list = list_of(head);
+    if (list == NULL) {
+        return 0;
     }
+    for (int attempt = 0; attempt < LIST_READ_ATTEMPTS; attempt++) {
+        int count = 0;
+        if (list_walk(list, count_visit, &count)) {
+            return count;
+        }
+    }
+    return list_count_nodes_locked(list);
+}
 
-    mem_deinit();
+// Usage of the pool the list nodes come from
+mem_stats_t list_memory_stats(Node** head) {
+    List* list = list_of(head);
+    return list ? mem_pool_stats(list->pool) : (mem_stats_t){0};
+}
+
+// The nodes go away with the list's pool in one step, no walk over the list is needed. Runs
+// with no other operation on this list in flight.
+void list_cleanup(Node** head) {
+    pthread_mutex_lock(&lists_lock);
+    List* list = list_of(head);
+    if (list != NULL) {
+        __atomic_store_n(&lists[list->index], NULL, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&lists_lock);
+
+    *head = NULL;
+    if (list != NULL) {
+        list_destroy(list);
+    }
 }
 
 
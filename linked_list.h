@@ -8,23 +8,29 @@
 typedef struct Node
 {
     uint16_t data;     // Stores the data as an unsigned 16-bit integer
+    uint8_t lock;      // Spinlock, 1 while held. Sits in the padding before next, a node is 16 bytes
+    uint8_t list;      // Index of the list the node belongs to, for calls that only get a node
     struct Node *next; // Pointer to the next node in the list
-    pthread_mutex_t lock;
-
 } Node;
 
 // Function declarations
 void list_init(Node **head, size_t size);
-void list_insert(Node **head, uint16_t data);
+void list_insert(Node **head, uint16_t data);                           // O(1), appends behind the list's tail
+void list_insert_walk(Node **head, uint16_t data);                      // Appends by walking from the head, for benchmarks
+void list_insert_bulk(Node **head, const uint16_t *data, size_t count); // Appends count values in order
 void list_insert_after(Node *prev_node, uint16_t data);
 void list_insert_before(Node **head, Node *next_node, uint16_t data);
 void list_delete(Node **head, uint16_t data);
-Node *list_search(Node **head, uint16_t data);
+Node *list_search(Node **head, uint16_t data); // The node may be freed by a concurrent list_delete unless
+                                               // the caller is between list_read_enter and list_read_exit
+void list_read_enter(Node **head);             // Nodes list_search returns from here on stay allocated
+void list_read_exit(Node **head);              // until the matching exit, sections nest
 
 void list_display(Node **head);
 void list_display_range(Node **head, Node *start_node, Node *end_node);
 
 int list_count_nodes(Node **head);
+mem_stats_t list_memory_stats(Node **head); // Stats of the list's own pool, zero before list_init
 void list_cleanup(Node **head);
 
 #endif // LINKED_LIST_H
@@ -0,0 +1,599 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "memory_manager.h"
+#include "linked_list.h"
+
+// Lock-free variant of linked_list.c with the same list_* API, after Harris and Michael: a node
+// is deleted by first setting the low bit of its next pointer and then unlinking it with a CAS,
+// and every traversal unlinks the marked nodes it passes. A node is linked in with a CAS on the
+// next pointer of its predecessor, which fails once the predecessor is marked: list_insert and
+// list_insert_bulk swing the NULL link at the end of the list, list_insert_after the link of
+// prev_node and list_insert_before the link that points at next_node. Node.lock is not used.
+//
+// Unlinked nodes are reclaimed with hazard pointers (Michael 2004): a thread publishes the nodes
+// it is about to dereference, and a retired node is only freed once no thread publishes it.
+
+// State of one list, found by the address of its head pointer as in linked_list.c. The hazard
+// pointer records are shared by all lists.
+typedef struct {
+    Node** head;
+    uint8_t index;         // Slot in lists, stored in every node
+    mem_pool_t* pool;      // The list's own bump pool, the default pool stays free for the application
+    mem_slab_t* node_slab; // Nodes come from a lock-free slab spanning the list's pool
+} List;
+
+#define LIST_MAX 256 // Live lists, Node.list is a single byte
+
+static List* lists[LIST_MAX];
+static int list_slots = 0; // Slots of lists ever used, lookups stop there
+static pthread_mutex_t lists_lock = PTHREAD_MUTEX_INITIALIZER; // Guards list_init and list_cleanup
+
+// NULL if head was not set up by list_init
+static List* list_of(Node** head) {
+    int slots = __atomic_load_n(&list_slots, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < slots; i++) {
+        List* list = __atomic_load_n(&lists[i], __ATOMIC_ACQUIRE);
+        if (list != NULL && list->head == head) {
+            return list;
+        }
+    }
+    return NULL;
+}
+
+// Writers need the list's pool, a head that list_init has not set up can't take nodes
+static List* list_for_write(Node** head) {
+    List* list = list_of(head);
+    if (list == NULL) {
+        fprintf(stderr, "List not initialized\n");
+    }
+    return list;
+}
+
+#define MARK ((uintptr_t)1)
+
+static bool is_marked(Node* node) {
+    return (uintptr_t)node & MARK;
+}
+
+static Node* marked(Node* node) {
+    return (Node*)((uintptr_t)node | MARK);
+}
+
+static Node* unmarked(Node* node) {
+    return (Node*)((uintptr_t)node & ~MARK);
+}
+
+static Node* link_load(Node** link) {
+    return __atomic_load_n(link, __ATOMIC_ACQUIRE);
+}
+
+static bool link_cas(Node** link, Node* expected, Node* desired) {
+    return __atomic_compare_exchange_n(link, &expected, desired, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// Hazard pointer slots of a thread, one for each node a traversal holds on to
+enum {
+    HP_NEXT,
+    HP_CURR,
+    HP_PREV, // Owner of the link the traversal would CAS
+    HP_SLOTS
+};
+
+// Records are never freed. A thread takes a free one on its first list operation and gives it
+// back when it exits, nodes it retired but could not free yet are inherited by the next owner.
+typedef struct HazardRecord {
+    Node* hp[HP_SLOTS];
+    int active;
+    struct HazardRecord* next;
+    Node** retired;
+    size_t retired_count;
+    size_t retired_capacity;
+} HazardRecord;
+
+#define RETIRE_THRESHOLD 64 // Retired nodes per thread before a scan, raised with the number of records
+
+static HazardRecord* hazard_records = NULL;
+static size_t hazard_record_count = 0;
+static __thread HazardRecord* my_record = NULL;
+static pthread_key_t record_key;
+static pthread_once_t record_key_once = PTHREAD_ONCE_INIT;
+
+static void hazard_scan(HazardRecord* record);
+
+static void record_release(void* arg) {
+    HazardRecord* record = arg;
+    hazard_scan(record);
+    for (int i = 0; i < HP_SLOTS; i++) {
+        __atomic_store_n(&record->hp[i], NULL, __ATOMIC_RELEASE);
+    }
+    __atomic_store_n(&record->active, 0, __ATOMIC_RELEASE);
+}
+
+static void record_key_create(void) {
+    pthread_key_create(&record_key, record_release);
+}
+
+static HazardRecord* hazard_record(void) {
+    if (my_record != NULL) {
+        return my_record;
+    }
+    pthread_once(&record_key_once, record_key_create);
+    HazardRecord* record;
+    for (record = __atomic_load_n(&hazard_records, __ATOMIC_ACQUIRE); record != NULL; record = record->next) {
+        int inactive = 0;
+        if (__atomic_load_n(&record->active, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&record->active, &inactive, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (record == NULL) {
+        record = calloc(1, sizeof(HazardRecord));
+        if (record == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        record->active = 1;
+        record->next = __atomic_load_n(&hazard_records, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&hazard_records, &record->next, record, true, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED)) {
+        }
+        __atomic_fetch_add(&hazard_record_count, 1, __ATOMIC_RELAXED);
+    }
+    pthread_setspecific(record_key, record);
+    my_record = record;
+    return record;
+}
+
+// The store has to be visible before the node is read again to validate it
+static void hazard_set(HazardRecord* record, int slot, Node* node) {
+    __atomic_store_n(&record->hp[slot], node, __ATOMIC_SEQ_CST);
+}
+
+static void hazard_clear(HazardRecord* record) {
+    for (int i = 0; i < HP_SLOTS; i++) {
+        __atomic_store_n(&record->hp[i], NULL, __ATOMIC_RELEASE);
+    }
+}
+
+// mem_slab_free ignores nodes from outside the slab
+static void node_free(Node* node) {
+    List* list = lists[node->list];
+    if (list->node_slab) {
+        mem_slab_free(list->node_slab, node);
+    } else {
+        mem_pool_free(list->pool, node);
+    }
+}
+
+static int compare_nodes(const void* a, const void* b) {
+    uintptr_t x = *(const uintptr_t*)a, y = *(const uintptr_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Frees the retired nodes of record that no thread has published
+static void hazard_scan(HazardRecord* record) {
+    // Records are only ever added, one that shows up after the walk was registered after the
+    // retired nodes were unlinked and can't have published them
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    HazardRecord* records = __atomic_load_n(&hazard_records, __ATOMIC_ACQUIRE);
+    size_t capacity = 0;
+    for (HazardRecord* other = records; other != NULL; other = other->next) {
+        capacity += HP_SLOTS;
+    }
+    Node** published = malloc(capacity * sizeof(Node*));
+    if (published == NULL) {
+        return; // Try again on the next retire
+    }
+    size_t count = 0;
+    for (HazardRecord* other = records; other != NULL; other = other->next) {
+        for (int i = 0; i < HP_SLOTS; i++) {
+            Node* node = __atomic_load_n(&other->hp[i], __ATOMIC_ACQUIRE);
+            if (node != NULL) {
+                published[count++] = node;
+            }
+        }
+    }
+    qsort(published, count, sizeof(Node*), compare_nodes);
+
+    size_t kept = 0;
+    for (size_t i = 0; i < record->retired_count; i++) {
+        Node* node = record->retired[i];
+        if (bsearch(&node, published, count, sizeof(Node*), compare_nodes)) {
+            record->retired[kept++] = node;
+        } else {
+            node_free(node);
+        }
+    }
+    record->retired_count = kept;
+    free(published);
+}
+
+static void hazard_retire(HazardRecord* record, Node* node) {
+    if (record->retired_count == record->retired_capacity) {
+        size_t capacity = record->retired_capacity ? record->retired_capacity * 2 : RETIRE_THRESHOLD;
+        Node** retired = realloc(record->retired, capacity * sizeof(Node*));
+        if (retired == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        record->retired = retired;
+        record->retired_capacity = capacity;
+    }
+    record->retired[record->retired_count++] = node;
+    size_t threshold = 2 * HP_SLOTS * __atomic_load_n(&hazard_record_count, __ATOMIC_RELAXED);
+    if (record->retired_count >= (threshold > RETIRE_THRESHOLD ? threshold : RETIRE_THRESHOLD)) {
+        hazard_scan(record);
+    }
+}
+
+// Position found by list_find: *prev is the link to curr, next is curr's successor
+typedef struct {
+    Node** prev;
+    Node* curr;
+    Node* next;
+} Position;
+
+// Michael's search. Walks from *head to the first live node that is target, or that holds key
+// if target is NULL, and unlinks the marked nodes on the way. visit, if given, sees every live
+// node passed before that one, and a NULL node whenever the walk has to start over. On return
+// curr and the owner of prev are protected by hazard pointers, curr is NULL and prev the link at
+// the end of the list if there is no such node. Returns whether there is one.
+static bool list_find(HazardRecord* record, Node** head, int key, Node* target, Position* position,
+                      void (*visit)(Node* node, void* arg), void* arg) {
+try_again:
+    if (visit) {
+        visit(NULL, arg);
+    }
+    position->prev = head;
+    position->curr = link_load(position->prev);
+    hazard_set(record, HP_CURR, position->curr);
+    if (link_load(position->prev) != position->curr) {
+        goto try_again;
+    }
+    while (true) {
+        Node* curr = position->curr;
+        if (curr == NULL) {
+            return false;
+        }
+        Node* next = link_load(&curr->next);
+        hazard_set(record, HP_NEXT, unmarked(next));
+        if (link_load(&curr->next) != next) {
+            goto try_again;
+        }
+        int data = curr->data;
+        if (link_load(position->prev) != curr) {
+            goto try_again; // The owner of prev was marked or curr was unlinked
+        }
+        if (!is_marked(next)) {
+            if (target ? curr == target : data == key) {
+                position->next = next;
+                return true;
+            }
+            if (visit) {
+                visit(curr, arg);
+            }
+            position->prev = &curr->next;
+            hazard_set(record, HP_PREV, curr);
+        } else if (link_cas(position->prev, curr, unmarked(next))) {
+            hazard_retire(record, curr);
+        } else {
+            goto try_again;
+        }
+        position->curr = unmarked(next);
+        hazard_set(record, HP_CURR, position->curr);
+    }
+}
+
+#define NO_KEY (-1) // Never held by a node, a walk with it goes to the end of the list
+
+// The pool can grow past size: retired nodes are only freed once no thread publishes them, so
+// a full list may briefly need more nodes than it holds
+#define RETIRED_HEADROOM (1 << 16)
+
+// Takes a free slot of lists, a list set up again on the same head first loses its old state
+void list_init(Node** head, size_t size) {
+    List* list = calloc(1, sizeof(List));
+    if (list == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    list->head = head;
+    list->pool = mem_pool_create_config(size, (mem_config_t){.engine = MEM_ENGINE_BUMP, .max_size = 2 * size + RETIRED_HEADROOM});
+    list->node_slab = mem_pool_slab_create(list->pool, sizeof(Node), size / sizeof(Node));
+
+    if (list_of(head) != NULL) {
+        list_cleanup(head);
+    }
+    pthread_mutex_lock(&lists_lock);
+    int slot = 0;
+    while (slot < LIST_MAX && lists[slot] != NULL) {
+        slot++;
+    }
+    if (slot == LIST_MAX) {
+        pthread_mutex_unlock(&lists_lock);
+        fprintf(stderr, "Too many lists\n");
+        exit(EXIT_FAILURE);
+    }
+    list->index = slot;
+    __atomic_store_n(&lists[slot], list, __ATOMIC_RELEASE);
+    if (slot == list_slots) {
+        __atomic_store_n(&list_slots, slot + 1, __ATOMIC_RELEASE);
+    }
+    *head = NULL;
+    pthread_mutex_unlock(&lists_lock);
+}
+
+// Nodes that don't fit in the slab come from the growing pool and stay there until list_cleanup
+static Node* node_create(HazardRecord* record, List* list, uint16_t data) {
+    Node* node = NULL;
+    if (list->node_slab) {
+        node = (Node*)mem_slab_alloc(list->node_slab);
+        if (node == NULL && record->retired_count > 0) {
+            hazard_scan(record);
+            node = (Node*)mem_slab_alloc(list->node_slab);
+        }
+    }
+    if (node == NULL) {
+        node = (Node*)mem_pool_alloc_uninit(list->pool, sizeof(Node));
+    }
+    if (node == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    node->data = data;
+    node->list = list->index;
+    return node;
+}
+
+// Links the chain first .. last in at the end of the list
+static void list_append(HazardRecord* record, List* list, Node* first, Node* last) {
+    Position position;
+    do {
+        list_find(record, list->head, NO_KEY, NULL, &position, NULL, NULL);
+        last->next = NULL;
+    } while (!link_cas(position.prev, NULL, first));
+    hazard_clear(record);
+}
+
+void list_insert(Node** head, uint16_t data) {
+    List* list = list_for_write(head);
+    if (list == NULL) {
+        return;
+    }
+    HazardRecord* record = hazard_record();
+    Node* node = node_create(record, list, data);
+    list_append(record, list, node, node);
+}
+
+// There is no tail to compare against, list_insert walks as well
+void list_insert_walk(Node** head, uint16_t data) {
+    list_insert(head, data);
+}
+
+// The nodes are chained up front, so the end of the list is found only once
+void list_insert_bulk(Node** head, const uint16_t* data, size_t count) {
+    List* list = list_for_write(head);
+    if (list == NULL || count == 0) {
+        return;
+    }
+    HazardRecord* record = hazard_record();
+    Node* first = node_create(record, list, data[0]);
+    Node* last = first;
+    for (size_t i = 1; i < count; i++) {
+        last->next = node_create(record, list, data[i]);
+        last = last->next;
+    }
+    list_append(record, list, first, last);
+}
+
+// prev_node has to stay allocated, for example as the result of list_search. Nothing is inserted
+// once it is deleted.
+void list_insert_after(Node* prev_node, uint16_t data) {
+    if (prev_node == NULL) {
+        fprintf(stderr, "Previous node cannot be NULL\n");
+        return;
+    }
+    HazardRecord* record = hazard_record();
+    Node* node = node_create(record, lists[prev_node->list], data);
+    Node* next;
+    do {
+        next = link_load(&prev_node->next);
+        if (is_marked(next)) {
+            fprintf(stderr, "Previous node was deleted\n");
+            node_free(node); // Never linked in
+            break;
+        }
+        node->next = next;
+    } while (!link_cas(&prev_node->next, next, node));
+    hazard_clear(record);
+}
+
+void list_insert_before(Node** head, Node* next_node, uint16_t data) {
+    if (next_node == NULL) {
+        fprintf(stderr, "Next node cannot be NULL\n");
+        return;
+    }
+    List* list = list_for_write(head);
+    if (list == NULL) {
+        return;
+    }
+    HazardRecord* record = hazard_record();
+    Node* node = node_create(record, list, data);
+    Position position;
+    do {
+        if (!list_find(record, head, NO_KEY, next_node, &position, NULL, NULL)) {
+            fprintf(stderr, "Next node not found in the list\n");
+            node_free(node); // Never linked in
+            break;
+        }
+        node->next = next_node;
+    } while (!link_cas(position.prev, next_node, node));
+    hazard_clear(record);
+}
+
+void list_delete(Node** head, uint16_t data) {
+    if (list_of(head) == NULL) {
+        return;
+    }
+    HazardRecord* record = hazard_record();
+    Position position;
+    while (list_find(record, head, data, NULL, &position, NULL, NULL)) {
+        // Marking the next pointer is the linearization point, whoever marks it owns the delete
+        if (!link_cas(&position.curr->next, position.next, marked(position.next))) {
+            continue;
+        }
+        if (link_cas(position.prev, position.curr, position.next)) {
+            hazard_retire(record, position.curr);
+        } else {
+            list_find(record, head, data, NULL, &position, NULL, NULL); // Unlinks it
+        }
+        break;
+    }
+    hazard_clear(record);
+}
+
+// The node found stays published in HP_CURR, so it is not freed before the calling thread's
+// next list call even if another thread deletes it. The result is only valid until then.
+Node* list_search(Node** head, uint16_t data) {
+    if (list_of(head) == NULL) {
+        return NULL;
+    }
+    HazardRecord* record = hazard_record();
+    Position position;
+    bool found = list_find(record, head, data, NULL, &position, NULL, NULL);
+    Node* node = found ? position.curr : NULL;
+    for (int i = 0; i < HP_SLOTS; i++) {
+        // HP_CURR already holds the node, clearing it first would leave it unprotected
+        __atomic_store_n(&record->hp[i], i == HP_CURR ? node : NULL, __ATOMIC_RELEASE);
+    }
+    return node;
+}
+
+// Hazard pointers protect single nodes, so a read section keeps only the node of the thread's
+// last list_search. Entering publishes nothing, the exit drops that node.
+void list_read_enter(Node** head) {
+}
+
+void list_read_exit(Node** head) {
+    if (list_of(head) != NULL) {
+        hazard_clear(hazard_record());
+    }
+}
+
+static void count_visit(Node* node, void* arg) {
+    int* count = arg;
+    *count = node ? *count + 1 : 0;
+}
+
+int list_count_nodes(Node** head) {
+    if (list_of(head) == NULL) {
+        return 0;
+    }
+    HazardRecord* record = hazard_record();
+    Position position;
+    int count = 0;
+    list_find(record, head, NO_KEY, NULL, &position, count_visit, &count);
+    hazard_clear(record);
+    return count;
+}
+typedef struct {
+    char buffer[1024];
+    size_t length;
+} DisplayWalk;
+
+static void display_visit(Node* node, void* arg) {
+    DisplayWalk* walk = arg;
+    if (node == NULL) {
+        walk->length = 1; // Start over after "["
+        walk->buffer[1] = '\0';
+    } else if (walk->length < sizeof(walk->buffer)) {
+        walk->length += snprintf(walk->buffer + walk->length, sizeof(walk->buffer) - walk->length,
+                                 walk->length > 1 ? ", %d" : "%d", node->data);
+    }
+}
+
+void list_display(Node** head) {
+    if (list_of(head) == NULL) {
+        printf("[]\n");
+        return;
+    }
+    HazardRecord* record = hazard_record();
+    Position position;
+    DisplayWalk walk = {"[", 1};
+    list_find(record, head, NO_KEY, NULL, &position, display_visit, &walk);
+    hazard_clear(record);
+    printf("%s]\n", walk.buffer);
+}
+
+// Not safe against concurrent deletes, like its counterpart in linked_list.c
+void list_display_range(Node** head, Node* start_node, Node* end_node) {
+    if (head == NULL || *head == NULL) {
+        printf("[]");
+        return;
+    }
+
+    char buffer[1024] = "[";
+    char temp[32];
+    int start_found = (start_node == NULL); // Start from the beginning if start_node is NULL
+
+    for (Node* current = *head; current != NULL; current = unmarked(current->next)) {
+        if (current == start_node) {
+            start_found = 1;
+        }
+        if (start_found) {
+            snprintf(temp, sizeof(temp), "%d", current->data);
+            strcat(buffer, temp);
+            if (unmarked(current->next) != NULL && current != end_node) {
+                strcat(buffer, ", ");
+            }
+        }
+        if (current == end_node) {
+            break;
+        }
+    }
+    strcat(buffer, "]");
+    printf("%s", buffer);
+}
+
+// Usage of the pool the list nodes come from
+mem_stats_t list_memory_stats(Node** head) {
+    List* list = list_of(head);
+    return list ? mem_pool_stats(list->pool) : (mem_stats_t){0};
+}
+
+// Runs with no operation on any lock-free list in flight, the retired lists and hazard pointers
+// of all threads are purged of the list's nodes, which go away with its pool
+void list_cleanup(Node** head) {
+    pthread_mutex_lock(&lists_lock);
+    List* list = list_of(head);
+    if (list != NULL) {
+        __atomic_store_n(&lists[list->index], NULL, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&lists_lock);
+    *head = NULL;
+    if (list == NULL) {
+        return;
+    }
+
+    for (HazardRecord* record = hazard_records; record != NULL; record = record->next) {
+        size_t kept = 0;
+        for (size_t i = 0; i < record->retired_count; i++) {
+            if (record->retired[i]->list != list->index) {
+                record->retired[kept++] = record->retired[i];
+            }
+        }
+        record->retired_count = kept;
+        for (int i = 0; i < HP_SLOTS; i++) {
+            if (record->hp[i] != NULL && record->hp[i]->list == list->index) {
+                record->hp[i] = NULL; // Dropped by list_search
+            }
+        }
+    }
+    mem_slab_destroy(list->node_slab);
+    mem_pool_destroy(list->pool);
+    free(list);
+}
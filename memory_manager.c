@@ -1,3 +1,4 @@
+#define _GNU_SOURCE // For sched_getcpu
 #include "memory_manager.h"
 #include <stdint.h>
 #include <stddef.h>
@@ -6,6 +7,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
 
 uintptr_t calculate_distance(void* ptr1, void* ptr2) {
     uintptr_t address1 = (uintptr_t)ptr1;
@@ -32,217 +38,3171 @@ typedef struct Block {
     size_t size;
     bool free;
     void* memory;
-    struct Block *next;
+    struct Block *next;      // Next block in address order
+    struct Block *prev;      // Previous block in address order, used for O(1) coalescing
+    struct Block *bin_next;  // Next free block in the same size-class bin
+    struct Block *bin_prev;  // Previous free block in the same size-class bin
 } Block;
 
-Block* block_array = NULL;
-size_t memory_pool_size = 0;
-void* memory_pool = NULL;
+// Free blocks are kept in segregated size-class bins. Each power of two is split
+// into four linear sub-classes, so a bin only holds blocks within 25% of each other.
+#define NUM_BINS 256
+#define BIN_WORDS (NUM_BINS / 64)
 
-pthread_mutex_t memory_mutex = PTHREAD_MUTEX_INITIALIZER;
+// Boundary-tag engine: every block starts with a header word holding its size and flags,
+// free blocks additionally carry their bin links after the header and a footer copy of
+// the size in their last word, so both neighbours of a block are found in O(1).
+typedef struct TagBlock {
+    size_t header;             // Block size (multiple of TAG_ALIGN) | TAG_FREE | TAG_PREV_FREE | TAG_CACHED
+    struct TagBlock *bin_next; // Only valid while the block is free
+    struct TagBlock *bin_prev; // Only valid while the block is free
+} TagBlock;
 
-void mem_init(size_t size) {
-    pthread_mutex_lock(&memory_mutex); // Lock helps to prevent multiple threads from initializing memory pool
-    memory_pool = malloc(size);
-    if (memory_pool == NULL) {
-        printf("Memory allocation failed\n");
+#define TAG_FREE ((size_t)1)
+#define TAG_PREV_FREE ((size_t)2)
+#define TAG_CACHED ((size_t)4) // Allocated block parked in a thread cache
+#define TAG_FLAGS (TAG_FREE | TAG_PREV_FREE | TAG_CACHED)
+#define TAG_ALIGN 16                                        // Minimum payload alignment, see block_align
+#define TAG_OVERHEAD sizeof(size_t)                         // Header word of an allocated block
+#define TAG_MIN_BLOCK (sizeof(TagBlock) + sizeof(size_t))   // Header, bin links and footer
+
+// Buddy engine: blocks are power-of-two sized and aligned relative to the arena base. Free
+// blocks sit in one list per order and have a bit in that order's bitmap, so the buddy of a
+// freed block is checked in O(1). Orders of allocated blocks are kept in a side map.
+typedef struct BuddyBlock {
+    struct BuddyBlock *next, *prev;
+} BuddyBlock;
+
+#define BUDDY_MIN_ORDER 4 // 16 bytes, room for the list links
+#define BUDDY_ORDERS 64
+
+// Allocated blocks of the block-list engine are indexed by their memory address in an
+// open-addressing hash table, so mem_free and mem_resize find them without a list walk.
+#define INDEX_MIN_CAPACITY 64
+
+// Calls counted per thread for mem_stats
+enum {
+    CALL_ALLOC,
+    CALL_FREE,
+    CALL_RESIZE,
+    CALL_FAILED_ALLOC,
+    CALL_KINDS
+};
+
+// The pool is carved into arenas: independently locked slices with their own engine state.
+// Threads allocate from their own arena and blocks are always freed back to the arena
+// whose slice they lie in.
+typedef struct Arena {
+    pthread_mutex_t mutex;
+    void* base;
+    size_t size;                 // Usable bytes from base, grows and shrinks in growable pools
+    size_t min_size;             // Size at mem_init, trimming never goes below it
+
+    Block* block_array;          // Block-list engine: all blocks in address order
+    Block* block_last;           // Block-list engine: last block in address order
+    Block** block_index;
+    size_t block_index_capacity; // Always a power of two
+    size_t block_index_count;
+    Block* free_bins[NUM_BINS];
+
+    TagBlock* tag_bins[NUM_BINS];
+    TagBlock* tag_first;         // First block of the boundary-tag heap
+    TagBlock* tag_end;           // Epilogue header, marks the end of the boundary-tag heap
+
+    uint64_t bin_bitmap[BIN_WORDS]; // Bit set for every non-empty bin, shared by both engines
+    void* size_tree;                // MEM_FIT_ADDRESS_BEST: free blocks of either engine, replaces the bins
+    void* rover;                    // MEM_FIT_NEXT: block the last search stopped at
+
+    char* bump_top;                 // Bump engine: first unused byte
+    char* bump_last;                // Bump engine: most recent allocation, NULL once freed or reset
+
+    BuddyBlock* buddy_lists[BUDDY_ORDERS]; // Buddy engine: free blocks per order, bin_bitmap[0] marks the non-empty ones
+    uint64_t* buddy_bits[BUDDY_ORDERS];    // Buddy engine: bit set for every free block, per order
+    uint8_t* buddy_orders;                 // Buddy engine: order + 1 of the allocated block starting in each granule
+    size_t buddy_min_order;                // Buddy engine: order of the smallest block
+
+    // Statistics for mem_stats, kept under the arena lock
+    size_t free_bytes;              // Block-list and boundary-tag engines: bytes in the bins
+    size_t free_histogram[MEM_FREE_BUCKETS]; // Free blocks per power of two, not kept by the bump engine
+    size_t block_count;             // Allocated blocks, the block-list engine counts its index instead
+    size_t peak_in_use;
+    uint64_t lock_waits;            // Acquisitions that found the lock taken
+    uint64_t lock_wait_ns;
+
+    struct mem_pool* pool;          // Pool the arena belongs to
+} Arena;
+
+#define POOL_ALIGN 64 // The pool starts on a cache line
+
+// Paths a resize can take, counted per pool for mem_resize_stats
+enum {
+    RESIZE_IN_PLACE,  // Shrunk or kept its size
+    RESIZE_FORWARD,   // Grew into the free space after it
+    RESIZE_BACKWARD,  // Grew into a free predecessor, the contents were moved down
+    RESIZE_RELOCATED, // Copied to another block of the same arena under the same lock
+    RESIZE_MOVED,     // Copied to another arena because its own was full
+    RESIZE_PATHS
+};
+
+// Engine of the default pool set up by mem_init, building with e.g.
+// -DMEM_DEFAULT_ENGINE=MEM_ENGINE_BUDDY runs code written against mem_init on another engine
+#ifndef MEM_DEFAULT_ENGINE
+#define MEM_DEFAULT_ENGINE MEM_ENGINE_BLOCK_LIST
+#endif
+
+// Threads keep one round-robin ticket for all pools, each pool maps it onto its own arenas
+size_t arena_next_ticket = 0;
+static __thread size_t arena_ticket = 0; // Round-robin slot of the calling thread, 0 until assigned
+
+// Per-thread caches of small blocks in front of the arena locks. Cached blocks stay allocated
+// as far as the engine is concerned and are chained through their first word. Requests are
+// served in TCACHE_UNIT steps, so class k (0-based) holds blocks of at least (k + 1) * 16 bytes.
+#define TCACHE_UNIT 16
+#define TCACHE_CLASSES 32
+#define TCACHE_MAX_SIZE (TCACHE_UNIT * TCACHE_CLASSES)
+#define TCACHE_PARKED 0xFF // class_map entry of a block sitting in a thread cache
+
+typedef struct ThreadCache {
+    void* heads[TCACHE_CLASSES];
+    size_t counts[TCACHE_CLASSES];
+    uint64_t hits;                   // Only written by the owning thread
+    uint64_t misses;                 // Only written by the owning thread
+    uint64_t calls[CALL_KINDS];      // Only written by the owning thread, kept even with caching disabled
+    struct ThreadCache *next, *prev; // Registry of all caches of the pool, guarded by its mutex
+    struct mem_pool* pool;
+} ThreadCache;
+
+// Everything a pool owns. mem_init and friends work on a default pool, the mem_pool_* functions
+// on any number of independent ones.
+struct mem_pool {
+    size_t size;
+    void* memory;
+    mem_engine_t engine;
+    size_t block_align; // Every block size and payload address is a multiple of this (mem_config_t.alignment)
+    mem_placement_t placement;
+    bool zero_in_lock;  // arenas_alloc zeroes blocks under the arena lock, mem_alloc then skips its memset
+
+    // Growable pools reserve address space for all arenas up front and commit it page by page,
+    // so blocks never move and arena_of keeps working while arenas grow and shrink.
+    bool growable;
+    size_t page_size;
+    size_t grow_chunk;     // Minimum number of bytes an arena grows by
+    size_t high_watermark; // Free bytes at the end of an arena that trigger a trim
+    size_t low_watermark;  // Free bytes left at the end of an arena after a trim
+
+    Arena* arenas;
+    size_t arena_count;
+    size_t arena_slice; // Bytes per arena, the last arena also takes the remainder
+    mem_arena_affinity_t arena_affinity;
+
+    pthread_mutex_t mutex; // Guards the thread cache registry, the arenas have their own locks
+
+    size_t tcache_depth;          // Blocks kept per class and thread, 0 disables the caches
+    pthread_key_t tcache_key;
+    ThreadCache* tcache_registry;
+    uint8_t* class_map;           // Block-list and buddy engines: cache class + 1 of the allocated block starting in
+                                  // each 16-byte granule, 0 once it is freed, TCACHE_PARKED while it is cached
+    uint64_t tcache_retired_hits; // Counters of caches whose threads have exited
+    uint64_t tcache_retired_misses;
+    uint64_t retired_calls[CALL_KINDS];
+    uint64_t tcache_refills;
+    uint64_t tcache_flushes;
+
+    uint64_t resize_counts[RESIZE_PATHS]; // Updated atomically, the arenas resize under their own locks
+};
+
+static mem_pool_t* default_pool = NULL;
+pthread_mutex_t memory_mutex = PTHREAD_MUTEX_INITIALIZER; // Guards setup and teardown of the default pool
+
+static void resize_count(mem_pool_t* pool, int path) {
+    __atomic_fetch_add(&pool->resize_counts[path], 1, __ATOMIC_RELAXED);
+}
+
+static size_t floor_log2(size_t value) {
+    return (sizeof(size_t) * 8 - 1) - __builtin_clzl(value);
+}
+
+static size_t size_class(size_t size) {
+    if (size < 4) {
+        return size;
+    }
+    size_t log2 = (sizeof(size_t) * 8 - 1) - __builtin_clzl(size);
+    size_t sub = (size >> (log2 - 2)) & 3;
+    return (log2 << 2) | sub;
+}
+
+// MEM_FIT_ADDRESS_BEST keeps the free blocks of an arena in a treap ordered by (size, address).
+// Blocks of both engines reuse their bin links as the left and right child, and priorities are
+// a hash of the node address, so the tree needs no space beyond what a free block already has.
+static void* tree_child(Arena* arena, void* node, int right) {
+    if (arena->pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        return right ? ((TagBlock*)node)->bin_prev : ((TagBlock*)node)->bin_next;
+    }
+    return right ? ((Block*)node)->bin_prev : ((Block*)node)->bin_next;
+}
+
+static void tree_set_child(Arena* arena, void* node, int right, void* child) {
+    if (arena->pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        if (right) {
+            ((TagBlock*)node)->bin_prev = child;
+        } else {
+            ((TagBlock*)node)->bin_next = child;
+        }
+    } else if (right) {
+        ((Block*)node)->bin_prev = child;
+    } else {
+        ((Block*)node)->bin_next = child;
+    }
+}
+
+static size_t tree_size(Arena* arena, void* node) {
+    if (arena->pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        return ((TagBlock*)node)->header & ~TAG_FLAGS;
+    }
+    return ((Block*)node)->size;
+}
+
+static uintptr_t tree_address(Arena* arena, void* node) {
+    return arena->pool->engine == MEM_ENGINE_BOUNDARY_TAG ? (uintptr_t)node : (uintptr_t)((Block*)node)->memory;
+}
+
+static bool tree_less(Arena* arena, void* a, void* b) {
+    size_t size_a = tree_size(arena, a);
+    size_t size_b = tree_size(arena, b);
+    return size_a < size_b || (size_a == size_b && tree_address(arena, a) < tree_address(arena, b));
+}
+
+static uint64_t tree_priority(void* node) {
+    return (uintptr_t)node * 0x9E3779B97F4A7C15ull;
+}
+
+static void* tree_insert(Arena* arena, void* root, void* node) {
+    if (root == NULL) {
+        tree_set_child(arena, node, 0, NULL);
+        tree_set_child(arena, node, 1, NULL);
+        return node;
+    }
+    int right = tree_less(arena, root, node);
+    void* child = tree_insert(arena, tree_child(arena, root, right), node);
+    tree_set_child(arena, root, right, child);
+    if (tree_priority(child) > tree_priority(root)) {
+        // Rotate the child above root
+        tree_set_child(arena, root, right, tree_child(arena, child, !right));
+        tree_set_child(arena, child, !right, root);
+        return child;
+    }
+    return root;
+}
+
+static void* tree_merge(Arena* arena, void* left, void* right) {
+    if (left == NULL) {
+        return right;
+    }
+    if (right == NULL) {
+        return left;
+    }
+    if (tree_priority(left) > tree_priority(right)) {
+        tree_set_child(arena, left, 1, tree_merge(arena, tree_child(arena, left, 1), right));
+        return left;
+    }
+    tree_set_child(arena, right, 0, tree_merge(arena, left, tree_child(arena, right, 0)));
+    return right;
+}
+
+// Removes node, which must be in the tree and still have the size it was inserted with
+static void* tree_remove(Arena* arena, void* root, void* node) {
+    if (root == node) {
+        return tree_merge(arena, tree_child(arena, root, 0), tree_child(arena, root, 1));
+    }
+    int right = tree_less(arena, root, node);
+    tree_set_child(arena, root, right, tree_remove(arena, tree_child(arena, root, right), node));
+    return root;
+}
+
+// Smallest block of at least size bytes, the lowest address among equal sizes
+static void* tree_find(Arena* arena, void* root, size_t size) {
+    void* best = NULL;
+    while (root != NULL) {
+        if (tree_size(arena, root) >= size) {
+            best = root;
+            root = tree_child(arena, root, 0);
+        } else {
+            root = tree_child(arena, root, 1);
+        }
+    }
+    return best;
+}
+
+// Keeps the next-fit rover and the last block pointer on a block start when the block they
+// point to is merged away
+static void block_absorbed(Arena* arena, void* absorbed, void* into) {
+    if (arena->rover == absorbed) {
+        arena->rover = into;
+    }
+    if (arena->block_last == absorbed) {
+        arena->block_last = into;
+    }
+}
+
+static void bin_insert(Arena* arena, Block* block) {
+    arena->free_bytes += block->size;
+    arena->free_histogram[floor_log2(block->size)]++;
+    if (arena->pool->placement == MEM_FIT_ADDRESS_BEST) {
+        arena->size_tree = tree_insert(arena, arena->size_tree, block);
+        return;
+    }
+    size_t bin = size_class(block->size);
+    block->bin_prev = NULL;
+    block->bin_next = arena->free_bins[bin];
+    if (arena->free_bins[bin] != NULL) {
+        arena->free_bins[bin]->bin_prev = block;
+    }
+    arena->free_bins[bin] = block;
+    arena->bin_bitmap[bin / 64] |= (uint64_t)1 << (bin % 64);
+}
+
+static void bin_remove(Arena* arena, Block* block) {
+    arena->free_bytes -= block->size;
+    arena->free_histogram[floor_log2(block->size)]--;
+    if (arena->pool->placement == MEM_FIT_ADDRESS_BEST) {
+        arena->size_tree = tree_remove(arena, arena->size_tree, block);
+        return;
+    }
+    size_t bin = size_class(block->size);
+    if (block->bin_prev != NULL) {
+        block->bin_prev->bin_next = block->bin_next;
+    } else {
+        arena->free_bins[bin] = block->bin_next;
+    }
+    if (block->bin_next != NULL) {
+        block->bin_next->bin_prev = block->bin_prev;
+    }
+    if (arena->free_bins[bin] == NULL) {
+        arena->bin_bitmap[bin / 64] &= ~((uint64_t)1 << (bin % 64));
+    }
+    block->bin_next = NULL;
+    block->bin_prev = NULL;
+}
+
+// Returns the first non-empty bin with an index greater than bin, or NUM_BINS if there is none
+static size_t next_nonempty_bin(Arena* arena, size_t bin) {
+    size_t start = bin + 1;
+    for (size_t word = start / 64; word < BIN_WORDS; word++) {
+        uint64_t bits = arena->bin_bitmap[word];
+        if (word == start / 64) {
+            bits &= ~(uint64_t)0 << (start % 64);
+        }
+        if (bits != 0) {
+            return word * 64 + __builtin_ctzll(bits);
+        }
+    }
+    return NUM_BINS;
+}
+
+// First free block of at least size bytes in address order, from first up to (excluding) end
+static Block* list_walk(Block* first, Block* end, size_t size) {
+    for (Block* current = first; current != end; current = current->next) {
+        if (current->free && current->size >= size) {
+            return current;
+        }
+    }
+    return NULL;
+}
+
+// Smallest fitting block of the request's bin or, if there is none, of the next non-empty bin
+static Block* bin_best(Arena* arena, size_t size) {
+    size_t bin = size_class(size);
+    Block* best = NULL;
+    for (Block* current = arena->free_bins[bin]; current != NULL; current = current->bin_next) {
+        if (current->size >= size && (best == NULL || current->size < best->size)) {
+            best = current;
+        }
+    }
+    if (best != NULL) {
+        return best;
+    }
+    bin = next_nonempty_bin(arena, bin);
+    for (Block* current = bin < NUM_BINS ? arena->free_bins[bin] : NULL; current != NULL; current = current->bin_next) {
+        if (best == NULL || current->size < best->size) {
+            best = current;
+        }
+    }
+    return best;
+}
+
+// Finds a free block of at least size bytes according to the placement policy. With
+// segregated fit only the request's own bin has to be scanned, every block in a larger
+// bin is guaranteed to fit.
+static Block* bin_find(Arena* arena, size_t size) {
+    switch (arena->pool->placement) {
+    case MEM_FIT_FIRST:
+        return list_walk(arena->block_array, NULL, size);
+    case MEM_FIT_NEXT: {
+        Block* start = arena->rover ? arena->rover : arena->block_array;
+        Block* found = list_walk(start, NULL, size);
+        if (found == NULL) {
+            found = list_walk(arena->block_array, start, size);
+        }
+        if (found != NULL) {
+            arena->rover = found;
+        }
+        return found;
+    }
+    case MEM_FIT_BEST:
+        return bin_best(arena, size);
+    case MEM_FIT_ADDRESS_BEST:
+        return tree_find(arena, arena->size_tree, size);
+    default:
+        break;
+    }
+    size_t bin = size_class(size);
+    for (Block* current = arena->free_bins[bin]; current != NULL; current = current->bin_next) {
+        if (current->size >= size) {
+            return current;
+        }
+    }
+    bin = next_nonempty_bin(arena, bin);
+    return bin < NUM_BINS ? arena->free_bins[bin] : NULL;
+}
+
+// Cuts block down to size bytes and returns the remainder as a new free block
+static void split_block(Arena* arena, Block* block, size_t size) {
+    Block* new_block = malloc(sizeof(Block));
+    if (!new_block) {
+        printf("Failed to allocate new block metadata\n");
+        pthread_mutex_unlock(&arena->mutex); // Unlock before exit
+        exit(1);
+    }
+    new_block->size = block->size - size;
+    new_block->free = true;
+    new_block->memory = (void*)((uintptr_t)block->memory + size);
+    new_block->next = block->next;
+    new_block->prev = block;
+    if (block->next != NULL) {
+        block->next->prev = new_block;
+    }
+
+    block->size = size;
+    block->next = new_block;
+    if (arena->block_last == block) {
+        arena->block_last = new_block;
+    }
+
+    // The remainder may border another free block (e.g. after a shrinking resize)
+    if (new_block->next != NULL && new_block->next->free) {
+        Block* temp = new_block->next;
+        bin_remove(arena, temp);
+        new_block->size += temp->size;
+        new_block->next = temp->next;
+        if (temp->next != NULL) {
+            temp->next->prev = new_block;
+        }
+        block_absorbed(arena, temp, new_block);
+        free(temp);
+    }
+    bin_insert(arena, new_block);
+}
+
+// Unlinks block->next from the address-ordered list and folds it into block
+static void absorb_next(Arena* arena, Block* block) {
+    Block* temp = block->next;
+    block->size += temp->size;
+    block->next = temp->next;
+    if (temp->next != NULL) {
+        temp->next->prev = block;
+    }
+    block_absorbed(arena, temp, block);
+    free(temp);
+}
+
+static size_t index_slot(Arena* arena, void* memory) {
+    // Fibonacci hashing spreads the byte addresses over the table
+    return (size_t)(((uintptr_t)memory * 0x9E3779B97F4A7C15ull) >> 32) & (arena->block_index_capacity - 1);
+}
+
+static void index_grow(Arena* arena) {
+    size_t old_capacity = arena->block_index_capacity;
+    Block** old_index = arena->block_index;
+
+    arena->block_index_capacity = old_capacity ? old_capacity * 2 : INDEX_MIN_CAPACITY;
+    arena->block_index = calloc(arena->block_index_capacity, sizeof(Block*));
+    if (!arena->block_index) {
+        printf("Failed to allocate block index\n");
+        pthread_mutex_unlock(&arena->mutex); // Unlock before exit
+        exit(1);
+    }
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_index[i] != NULL) {
+            size_t slot = index_slot(arena, old_index[i]->memory);
+            while (arena->block_index[slot] != NULL) {
+                slot = (slot + 1) & (arena->block_index_capacity - 1);
+            }
+            arena->block_index[slot] = old_index[i];
+        }
+    }
+    free(old_index);
+}
+
+static void index_insert(Arena* arena, Block* block) {
+    if ((arena->block_index_count + 1) * 2 > arena->block_index_capacity) {
+        index_grow(arena); // Keep the load factor at or below one half
+    }
+    size_t slot = index_slot(arena, block->memory);
+    while (arena->block_index[slot] != NULL) {
+        slot = (slot + 1) & (arena->block_index_capacity - 1);
+    }
+    arena->block_index[slot] = block;
+    arena->block_index_count++;
+}
+
+static Block* index_find(Arena* arena, void* memory) {
+    if (arena->block_index == NULL) {
+        return NULL;
+    }
+    size_t slot = index_slot(arena, memory);
+    while (arena->block_index[slot] != NULL) {
+        if (arena->block_index[slot]->memory == memory) {
+            return arena->block_index[slot];
+        }
+        slot = (slot + 1) & (arena->block_index_capacity - 1);
+    }
+    return NULL;
+}
+
+// Removes block from the index, shifting later entries of its probe run back into the gap
+static void index_remove(Arena* arena, Block* block) {
+    size_t mask = arena->block_index_capacity - 1;
+    size_t slot = index_slot(arena, block->memory);
+    while (arena->block_index[slot] != block) {
+        slot = (slot + 1) & mask;
+    }
+    arena->block_index[slot] = NULL;
+    arena->block_index_count--;
+
+    size_t next = (slot + 1) & mask;
+    while (arena->block_index[next] != NULL) {
+        size_t home = index_slot(arena, arena->block_index[next]->memory);
+        // Move the entry if its home slot is not in the (cyclic) range (slot, next]
+        if (((next - home) & mask) >= ((next - slot) & mask)) {
+            arena->block_index[slot] = arena->block_index[next];
+            arena->block_index[next] = NULL;
+            slot = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
+static size_t tag_size(TagBlock* block) {
+    return block->header & ~TAG_FLAGS;
+}
+
+static TagBlock* tag_next(TagBlock* block) {
+    return (TagBlock*)((uintptr_t)block + tag_size(block));
+}
+
+static void tag_write_footer(TagBlock* block) {
+    *(size_t*)((uintptr_t)block + tag_size(block) - sizeof(size_t)) = tag_size(block);
+}
+
+static void tag_bin_insert(Arena* arena, TagBlock* block) {
+    arena->free_bytes += tag_size(block);
+    arena->free_histogram[floor_log2(tag_size(block))]++;
+    if (arena->pool->placement == MEM_FIT_ADDRESS_BEST) {
+        arena->size_tree = tree_insert(arena, arena->size_tree, block);
+        return;
+    }
+    size_t bin = size_class(tag_size(block));
+    block->bin_prev = NULL;
+    block->bin_next = arena->tag_bins[bin];
+    if (arena->tag_bins[bin] != NULL) {
+        arena->tag_bins[bin]->bin_prev = block;
+    }
+    arena->tag_bins[bin] = block;
+    arena->bin_bitmap[bin / 64] |= (uint64_t)1 << (bin % 64);
+}
+
+static void tag_bin_remove(Arena* arena, TagBlock* block) {
+    arena->free_bytes -= tag_size(block);
+    arena->free_histogram[floor_log2(tag_size(block))]--;
+    if (arena->pool->placement == MEM_FIT_ADDRESS_BEST) {
+        arena->size_tree = tree_remove(arena, arena->size_tree, block);
+        return;
+    }
+    size_t bin = size_class(tag_size(block));
+    if (block->bin_prev != NULL) {
+        block->bin_prev->bin_next = block->bin_next;
+    } else {
+        arena->tag_bins[bin] = block->bin_next;
+    }
+    if (block->bin_next != NULL) {
+        block->bin_next->bin_prev = block->bin_prev;
+    }
+    if (arena->tag_bins[bin] == NULL) {
+        arena->bin_bitmap[bin / 64] &= ~((uint64_t)1 << (bin % 64));
+    }
+}
+
+static TagBlock* tag_walk(TagBlock* first, TagBlock* end, size_t size) {
+    for (TagBlock* current = first; current < end; current = tag_next(current)) {
+        if ((current->header & TAG_FREE) && tag_size(current) >= size) {
+            return current;
+        }
+    }
+    return NULL;
+}
+
+static TagBlock* tag_bin_best(Arena* arena, size_t size) {
+    size_t bin = size_class(size);
+    TagBlock* best = NULL;
+    for (TagBlock* current = arena->tag_bins[bin]; current != NULL; current = current->bin_next) {
+        if (tag_size(current) >= size && (best == NULL || tag_size(current) < tag_size(best))) {
+            best = current;
+        }
+    }
+    if (best != NULL) {
+        return best;
+    }
+    bin = next_nonempty_bin(arena, bin);
+    for (TagBlock* current = bin < NUM_BINS ? arena->tag_bins[bin] : NULL; current != NULL; current = current->bin_next) {
+        if (best == NULL || tag_size(current) < tag_size(best)) {
+            best = current;
+        }
+    }
+    return best;
+}
+
+// Placement policies as in bin_find
+static TagBlock* tag_bin_find(Arena* arena, size_t size) {
+    switch (arena->pool->placement) {
+    case MEM_FIT_FIRST:
+        return tag_walk(arena->tag_first, arena->tag_end, size);
+    case MEM_FIT_NEXT: {
+        TagBlock* start = arena->rover ? arena->rover : arena->tag_first;
+        TagBlock* found = tag_walk(start, arena->tag_end, size);
+        if (found == NULL) {
+            found = tag_walk(arena->tag_first, start, size);
+        }
+        if (found != NULL) {
+            arena->rover = found;
+        }
+        return found;
+    }
+    case MEM_FIT_BEST:
+        return tag_bin_best(arena, size);
+    case MEM_FIT_ADDRESS_BEST:
+        return tree_find(arena, arena->size_tree, size);
+    default:
+        break;
+    }
+    size_t bin = size_class(size);
+    for (TagBlock* current = arena->tag_bins[bin]; current != NULL; current = current->bin_next) {
+        if (tag_size(current) >= size) {
+            return current;
+        }
+    }
+    bin = next_nonempty_bin(arena, bin);
+    return bin < NUM_BINS ? arena->tag_bins[bin] : NULL;
+}
+
+// Block size needed to hand out a payload of size bytes
+static size_t tag_block_size(Arena* arena, size_t size) {
+    size_t align = arena->pool->block_align;
+    size_t block_size = (size + TAG_OVERHEAD + align - 1) & ~(align - 1);
+    return block_size < TAG_MIN_BLOCK ? TAG_MIN_BLOCK : block_size;
+}
+
+// The successor may be an allocated block whose size a thread cache reads without the lock,
+// so its PREV_FREE bit is flipped atomically instead of rewriting the whole header.
+static void tag_set_prev_free(TagBlock* block, bool prev_free) {
+    if (prev_free) {
+        __atomic_fetch_or(&block->header, TAG_PREV_FREE, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_and(&block->header, ~TAG_PREV_FREE, __ATOMIC_RELAXED);
+    }
+}
+
+// Turns block into a free block: flags, footer, bin and the PREV_FREE bit of its successor
+static void tag_make_free(Arena* arena, TagBlock* block, size_t size) {
+    block->header = size | TAG_FREE | (block->header & TAG_PREV_FREE);
+    tag_write_footer(block);
+    tag_set_prev_free(tag_next(block), true);
+    tag_bin_insert(arena, block);
+}
+
+// Keeps the first block_size bytes of an allocated block and frees the rest if it can hold a block
+static void tag_trim(Arena* arena, TagBlock* block, size_t block_size) {
+    size_t remainder = tag_size(block) - block_size;
+    if (remainder < TAG_MIN_BLOCK) {
+        return;
+    }
+    block->header = block_size | (block->header & TAG_PREV_FREE);
+    TagBlock* rest = tag_next(block);
+    rest->header = 0;
+
+    // The remainder may border another free block (e.g. after a shrinking resize)
+    TagBlock* next = (TagBlock*)((uintptr_t)rest + remainder);
+    if (next->header & TAG_FREE) {
+        tag_bin_remove(arena, next);
+        remainder += tag_size(next);
+        block_absorbed(arena, next, rest);
+    }
+    tag_make_free(arena, rest, remainder);
+}
+
+// Hands out the first block_size bytes of the free block
+static void* tag_take(Arena* arena, TagBlock* block, size_t block_size) {
+    arena->block_count++;
+    tag_bin_remove(arena, block);
+    block->header &= ~TAG_FREE;
+    tag_set_prev_free(tag_next(block), false);
+    tag_trim(arena, block, block_size);
+    return (void*)((uintptr_t)block + TAG_OVERHEAD);
+}
+
+static void* tag_alloc(Arena* arena, size_t size) {
+    size_t block_size = tag_block_size(arena, size);
+    TagBlock* block = tag_bin_find(arena, block_size);
+    if (block == NULL) {
+        return NULL;
+    }
+    return tag_take(arena, block, block_size);
+}
+
+// Hands out up to count blocks, carving each one from the rest of the previous one as long as
+// it is large enough. Returns the number of blocks written to out.
+static size_t tag_alloc_run(Arena* arena, size_t size, size_t count, void** out) {
+    size_t block_size = tag_block_size(arena, size);
+    size_t n = 0;
+    TagBlock* block = NULL;
+    while (n < count) {
+        if (block == NULL && (block = tag_bin_find(arena, block_size)) == NULL) {
+            break;
+        }
+        out[n++] = tag_take(arena, block, block_size);
+        TagBlock* next = tag_next(block); // The epilogue is never free
+        block = (next->header & TAG_FREE) && tag_size(next) >= block_size ? next : NULL;
+    }
+    return n;
+}
+
+// Allocation whose payload is aligned to more than block_align. The block is taken with room
+// for a front gap, which is cut off as a free block of its own.
+static void* tag_alloc_aligned(Arena* arena, size_t size, size_t alignment) {
+    size_t block_size = tag_block_size(arena, size);
+    TagBlock* block = tag_bin_find(arena, block_size + alignment + TAG_MIN_BLOCK);
+    if (block == NULL) {
+        return NULL;
+    }
+    tag_bin_remove(arena, block);
+    arena->block_count++;
+    uintptr_t payload = (uintptr_t)block + TAG_OVERHEAD;
+    size_t gap = ((payload + alignment - 1) & ~(alignment - 1)) - payload;
+    if (gap > 0 && gap < TAG_MIN_BLOCK) {
+        gap += alignment; // The gap has to hold a free block
+    }
+
+    if (gap > 0) {
+        TagBlock* aligned = (TagBlock*)((uintptr_t)block + gap);
+        aligned->header = tag_size(block) - gap;
+        tag_make_free(arena, block, gap); // Also marks aligned as PREV_FREE
+        block = aligned;
+    } else {
+        block->header &= ~TAG_FREE;
+    }
+    tag_set_prev_free(tag_next(block), false);
+    tag_trim(arena, block, block_size);
+    return (void*)((uintptr_t)block + TAG_OVERHEAD);
+}
+
+// Maps a user pointer back to its header, NULL if it can't be an allocated block of the arena.
+// A block parked in a thread cache is not one, the cache still owns it.
+static TagBlock* tag_lookup(Arena* arena, void* ptr) {
+    TagBlock* block = (TagBlock*)((uintptr_t)ptr - TAG_OVERHEAD);
+    if (ptr == NULL || block < arena->tag_first || block >= arena->tag_end ||
+        ((uintptr_t)block - (uintptr_t)arena->tag_first) % TAG_ALIGN != 0 || (block->header & (TAG_FREE | TAG_CACHED))) {
+        return NULL;
+    }
+    return block;
+}
+
+static void tag_free(Arena* arena, TagBlock* block) {
+    size_t size = tag_size(block);
+    arena->block_count--;
+
+    // Coalesce with the next block
+    TagBlock* next = tag_next(block);
+    if (next->header & TAG_FREE) {
+        tag_bin_remove(arena, next);
+        size += tag_size(next);
+        block_absorbed(arena, next, block);
+    }
+
+    // Coalesce with the previous block, its footer sits right before our header
+    if (block->header & TAG_PREV_FREE) {
+        size_t prev_size = *(size_t*)((uintptr_t)block - sizeof(size_t));
+        TagBlock* prev = (TagBlock*)((uintptr_t)block - prev_size);
+        tag_bin_remove(arena, prev);
+        size += prev_size;
+        block_absorbed(arena, block, prev);
+        block->header = TAG_FREE; // Left inside prev, a second free of the block now finds it free
+        block = prev;
+    }
+    tag_make_free(arena, block, size);
+}
+
+// Resizes within the arena, returns NULL if the block can't be resized or moved inside it
+static void* tag_resize(Arena* arena, TagBlock* block, size_t size) {
+    void* memory = (void*)((uintptr_t)block + TAG_OVERHEAD);
+    size_t block_size = tag_block_size(arena, size);
+    if (block_size <= tag_size(block)) {
+        tag_trim(arena, block, block_size);
+        resize_count(arena->pool, RESIZE_IN_PLACE);
+        return memory;
+    }
+
+    // Grow forward into a free successor
+    TagBlock* next = tag_next(block);
+    size_t forward = tag_size(block) + ((next->header & TAG_FREE) ? tag_size(next) : 0);
+    if (forward >= block_size) {
+        tag_bin_remove(arena, next);
+        block_absorbed(arena, next, block);
+        block->header += tag_size(next);
+        tag_set_prev_free(tag_next(block), false);
+        tag_trim(arena, block, block_size);
+        resize_count(arena->pool, RESIZE_FORWARD);
+        return memory;
+    }
+
+    // Grow backward into a free predecessor, taking a free successor along
+    if (block->header & TAG_PREV_FREE) {
+        size_t prev_size = *(size_t*)((uintptr_t)block - sizeof(size_t));
+        TagBlock* prev = (TagBlock*)((uintptr_t)block - prev_size);
+        if (prev_size + forward >= block_size) {
+            size_t payload = tag_size(block) - TAG_OVERHEAD;
+            if (next->header & TAG_FREE) {
+                tag_bin_remove(arena, next);
+                block_absorbed(arena, next, prev);
+            }
+            tag_bin_remove(arena, prev);
+            block_absorbed(arena, block, prev);
+            prev->header = prev_size + forward; // A free block never follows another free block
+            tag_set_prev_free(tag_next(prev), false);
+            void* new_memory = (void*)((uintptr_t)prev + TAG_OVERHEAD);
+            memmove(new_memory, memory, payload);
+            tag_trim(arena, prev, block_size);
+            resize_count(arena->pool, RESIZE_BACKWARD);
+            return new_memory;
+        }
+    }
+
+    // Relocate within the arena, all under the lock the caller holds
+    void* new_memory = tag_alloc(arena, size);
+    if (new_memory) {
+        memcpy(new_memory, memory, tag_size(block) - TAG_OVERHEAD);
+        tag_free(arena, block);
+        resize_count(arena->pool, RESIZE_RELOCATED);
+    }
+    return new_memory;
+}
+
+// Lays out the boundary-tag heap: payloads are block_align aligned, so the first header sits
+// one word before an aligned address and an allocated epilogue header closes the heap.
+static void tag_init(Arena* arena) {
+    size_t block_align = arena->pool->block_align;
+    arena->tag_first = NULL;
+    arena->tag_end = NULL;
+    uintptr_t start = ((uintptr_t)arena->base + TAG_OVERHEAD + block_align - 1) / block_align * block_align - TAG_OVERHEAD;
+    uintptr_t arena_end = (uintptr_t)arena->base + arena->size;
+    if (arena_end < start + TAG_OVERHEAD) {
+        return; // Not even room for the epilogue
+    }
+
+    size_t area = (arena_end - start - TAG_OVERHEAD) / block_align * block_align;
+    if (area < TAG_MIN_BLOCK) {
+        area = 0; // Arena too small to hold a single block
+    }
+    arena->tag_first = (TagBlock*)start;
+    arena->tag_end = (TagBlock*)(start + area);
+    arena->tag_end->header = 0;
+    if (area > 0) {
+        arena->tag_first->header = 0;
+        tag_make_free(arena, arena->tag_first, area);
+    }
+}
+
+// units is the cache class + 1 of the block at memory, 0 once it is freed
+static void class_map_set(mem_pool_t* pool, void* memory, size_t units) {
+    if (pool->class_map) {
+        pool->class_map[((uintptr_t)memory - (uintptr_t)pool->memory) / TCACHE_UNIT] = units;
+    }
+}
+
+static void list_record_class(Arena* arena, Block* block) {
+    class_map_set(arena->pool, block->memory, block->size <= TCACHE_MAX_SIZE ? block->size / TCACHE_UNIT : 0);
+}
+
+// Request size as stored by the block-list engine
+static size_t list_request_size(Arena* arena, size_t size) {
+    mem_pool_t* pool = arena->pool;
+    if (size == 0) {
+        size = 1; // Every block needs its own address for the pointer index
+    }
+    if (pool->tcache_depth > 0) {
+        size = (size + TCACHE_UNIT - 1) & ~(size_t)(TCACHE_UNIT - 1); // Keeps blocks on class_map granules
+    }
+    return (size + pool->block_align - 1) & ~(pool->block_align - 1);
+}
+
+// Hands out the first size bytes of the free block
+static void* list_take(Arena* arena, Block* current, size_t size) {
+    bin_remove(arena, current);
+    // Split the block if it's larger than needed
+    if (current->size > size) {
+        split_block(arena, current, size);
+    }
+    current->free = false;
+    index_insert(arena, current);
+    list_record_class(arena, current);
+    return current->memory;
+}
+
+// Block-list engine allocation, called with the arena lock held
+static void* list_alloc(Arena* arena, size_t size) {
+    size = list_request_size(arena, size);
+    Block* current = bin_find(arena, size);
+    if (current == NULL) {
+        return NULL; // No suitable block found
+    }
+    return list_take(arena, current, size);
+}
+
+// Hands out up to count blocks, carving each one from the rest of the previous one as long as
+// it is large enough. Returns the number of blocks written to out.
+static size_t list_alloc_run(Arena* arena, size_t size, size_t count, void** out) {
+    size = list_request_size(arena, size);
+    size_t n = 0;
+    Block* current = NULL;
+    while (n < count) {
+        if (current == NULL && (current = bin_find(arena, size)) == NULL) {
+            break;
+        }
+        out[n++] = list_take(arena, current, size);
+        Block* next = current->next;
+        current = next != NULL && next->free && next->size >= size ? next : NULL;
+    }
+    return n;
+}
+
+// Allocation whose address is aligned to more than the engine guarantees. The block is taken
+// with room for a front gap, which stays behind as a free block of its own.
+static void* list_alloc_aligned(Arena* arena, size_t size, size_t alignment) {
+    size = list_request_size(arena, size);
+    Block* current = bin_find(arena, size + alignment - 1);
+    if (current == NULL) {
+        return NULL; // No suitable block found
+    }
+
+    bin_remove(arena, current);
+    uintptr_t memory = (uintptr_t)current->memory;
+    size_t gap = ((memory + alignment - 1) & ~(alignment - 1)) - memory;
+    if (gap > 0) {
+        split_block(arena, current, gap); // The rest goes into a bin, take it back out
+        bin_insert(arena, current);
+        current = current->next;
+        bin_remove(arena, current);
+    }
+    if (current->size > size) {
+        split_block(arena, current, size);
+    }
+    current->free = false;
+    index_insert(arena, current);
+    list_record_class(arena, current);
+    return current->memory;
+}
+
+// Turns an allocated block that is already out of the index into a free one
+static void list_release(Arena* arena, Block* current) {
+    current->free = true;
+
+    // Coalesce with the next block
+    if (current->next != NULL && current->next->free) {
+        bin_remove(arena, current->next);
+        absorb_next(arena, current);
+    }
+
+    // Coalesce with the previous block
+    if (current->prev != NULL && current->prev->free) {
+        Block* prev = current->prev;
+        bin_remove(arena, prev);
+        absorb_next(arena, prev);
+        current = prev;
+    }
+
+    bin_insert(arena, current);
+}
+
+static void list_free(Arena* arena, Block* current) {
+    class_map_set(arena->pool, current->memory, 0);
+    index_remove(arena, current);
+    list_release(arena, current);
+}
+
+// Frees blocks[0] and the blocks directly after it that are in blocks as well, merging the
+// run before it goes into a bin. blocks is sorted by address. Returns how many were consumed.
+static size_t list_free_run(Arena* arena, void** blocks, size_t count) {
+    Block* current = index_find(arena, blocks[0]);
+    if (current == NULL) {
+        return 1;
+    }
+    class_map_set(arena->pool, current->memory, 0);
+    index_remove(arena, current);
+    size_t n = 1;
+    while (n < count && current->next != NULL && !current->next->free && current->next->memory == blocks[n]) {
+        class_map_set(arena->pool, blocks[n], 0);
+        index_remove(arena, current->next);
+        absorb_next(arena, current);
+        n++;
+    }
+    list_release(arena, current);
+    return n;
+}
+
+// Resizes within the arena under the lock the caller holds, returns NULL if the block can't
+// be resized or moved inside it
+static void* list_resize(Arena* arena, Block* current, size_t size) {
+    size = list_request_size(arena, size);
+    if (current->size >= size) {
+        if (current->size > size) {
+            split_block(arena, current, size);
+            list_record_class(arena, current);
+        }
+        resize_count(arena->pool, RESIZE_IN_PLACE);
+        return current->memory;
+    }
+
+    // Grow forward into a free successor
+    Block* next = current->next != NULL && current->next->free ? current->next : NULL;
+    size_t forward = current->size + (next ? next->size : 0);
+    if (forward >= size) {
+        bin_remove(arena, next);
+        absorb_next(arena, current);
+        if (current->size > size) {
+            split_block(arena, current, size);
+        }
+        list_record_class(arena, current);
+        resize_count(arena->pool, RESIZE_FORWARD);
+        return current->memory;
+    }
+
+    // Grow backward into a free predecessor, taking a free successor along
+    Block* prev = current->prev;
+    if (prev != NULL && prev->free && prev->size + forward >= size) {
+        void* old_memory = current->memory;
+        size_t old_size = current->size;
+        class_map_set(arena->pool, old_memory, 0);
+        index_remove(arena, current);
+        if (next) {
+            bin_remove(arena, next);
+            absorb_next(arena, current);
+        }
+        bin_remove(arena, prev);
+        absorb_next(arena, prev);
+        prev->free = false;
+        memmove(prev->memory, old_memory, old_size);
+        if (prev->size > size) {
+            split_block(arena, prev, size);
+        }
+        index_insert(arena, prev);
+        list_record_class(arena, prev);
+        resize_count(arena->pool, RESIZE_BACKWARD);
+        return prev->memory;
+    }
+
+    // Relocate within the arena
+    void* new_memory = list_alloc(arena, size);
+    if (new_memory) {
+        memcpy(new_memory, current->memory, current->size);
+        list_free(arena, current);
+        resize_count(arena->pool, RESIZE_RELOCATED);
+    }
+    return new_memory;
+}
+
+static void list_init(Arena* arena) {
+    // Initialize the metadata array with a single large block
+    arena->block_array = malloc(sizeof(Block));
+    if (!arena->block_array) {
+        printf("Failed to allocate metadata array\n");
+        exit(1);
+    }
+
+    arena->block_array->size = arena->size;
+    arena->block_array->free = true;
+    arena->block_array->memory = arena->base;
+    arena->block_array->next = NULL;
+    arena->block_array->prev = NULL;
+    arena->block_last = arena->block_array;
+    bin_insert(arena, arena->block_array);
+}
+
+// Bump engine: allocation moves the top of the arena up, memory only comes back through
+// mem_reset and markers, apart from the most recent allocation which can be freed or resized.
+static void* bump_alloc(Arena* arena, size_t size, size_t alignment) {
+    size_t align = alignment > arena->pool->block_align ? alignment : arena->pool->block_align;
+    if (size == 0) {
+        size = 1; // Every block gets its own address
+    }
+    size = (size + arena->pool->block_align - 1) & ~(arena->pool->block_align - 1);
+    uintptr_t start = ((uintptr_t)arena->bump_top + align - 1) & ~(uintptr_t)(align - 1);
+    uintptr_t end = (uintptr_t)arena->base + arena->size;
+    if (start > end || size > end - start) {
+        return NULL;
+    }
+    arena->bump_top = (char*)(start + size);
+    arena->bump_last = (char*)start;
+    arena->block_count++;
+    return (void*)start;
+}
+
+static void bump_free(Arena* arena, void* block) {
+    if (block != NULL && block == arena->bump_last) {
+        arena->bump_top = arena->bump_last;
+        arena->bump_last = NULL;
+        arena->block_count--;
+    }
+}
+
+// Only the most recent block changes size in place, older ones are copied to the top. Their
+// size is not recorded, so *copy is set to what can belong to them.
+static void* bump_resize(Arena* arena, void* block, size_t size, size_t* copy) {
+    if ((char*)block >= arena->bump_top) {
+        return NULL; // Block not found
+    }
+    if (block == arena->bump_last && size <= (uintptr_t)arena->base + arena->size - (uintptr_t)block) {
+        char* top = (char*)block + (size > 0 ? size : 1);
+        resize_count(arena->pool, top > arena->bump_top ? RESIZE_FORWARD : RESIZE_IN_PLACE);
+        arena->bump_top = top;
+        return block;
+    }
+    *copy = arena->bump_top - (char*)block;
+    if (*copy > size) {
+        *copy = size;
+    }
+    void* new_memory = bump_alloc(arena, size, 0);
+    if (new_memory) {
+        memcpy(new_memory, block, *copy);
+        resize_count(arena->pool, RESIZE_RELOCATED);
+    }
+    return new_memory;
+}
+
+static void bump_init(Arena* arena) {
+    arena->bump_top = arena->base;
+    arena->bump_last = NULL;
+}
+
+// Order of the smallest block holding size bytes
+static size_t buddy_order(Arena* arena, size_t size) {
+    size_t order = size > 1 ? floor_log2(size - 1) + 1 : 0;
+    return order > arena->buddy_min_order ? order : arena->buddy_min_order;
+}
+
+static bool buddy_is_free(Arena* arena, size_t offset, size_t order) {
+    size_t index = offset >> order;
+    return (arena->buddy_bits[order][index / 64] >> (index % 64)) & 1;
+}
+
+static void buddy_push(Arena* arena, size_t offset, size_t order) {
+    BuddyBlock* block = (BuddyBlock*)((uintptr_t)arena->base + offset);
+    arena->free_histogram[order]++;
+    arena->free_bytes += (size_t)1 << order;
+    size_t index = offset >> order;
+    block->prev = NULL;
+    block->next = arena->buddy_lists[order];
+    if (block->next != NULL) {
+        block->next->prev = block;
+    }
+    arena->buddy_lists[order] = block;
+    arena->buddy_bits[order][index / 64] |= (uint64_t)1 << (index % 64);
+    arena->bin_bitmap[0] |= (uint64_t)1 << order;
+}
+
+static void buddy_unlink(Arena* arena, size_t offset, size_t order) {
+    BuddyBlock* block = (BuddyBlock*)((uintptr_t)arena->base + offset);
+    arena->free_histogram[order]--;
+    arena->free_bytes -= (size_t)1 << order;
+    size_t index = offset >> order;
+    if (block->prev != NULL) {
+        block->prev->next = block->next;
+    } else {
+        arena->buddy_lists[order] = block->next;
+    }
+    if (block->next != NULL) {
+        block->next->prev = block->prev;
+    }
+    arena->buddy_bits[order][index / 64] &= ~((uint64_t)1 << (index % 64));
+    if (arena->buddy_lists[order] == NULL) {
+        arena->bin_bitmap[0] &= ~((uint64_t)1 << order);
+    }
+}
+
+// Frees the block at offset, merging it with its buddy for as long as the buddy is free
+static void buddy_release(Arena* arena, size_t offset, size_t order) {
+    for (;;) {
+        size_t buddy = offset ^ ((size_t)1 << order);
+        if (buddy + ((size_t)1 << order) > arena->size || !buddy_is_free(arena, buddy, order)) {
+            break;
+        }
+        buddy_unlink(arena, buddy, order);
+        offset &= ~((size_t)1 << order);
+        order++;
+    }
+    buddy_push(arena, offset, order);
+}
+
+// Serves size bytes with one block of the smallest order that holds them, splitting a larger free
+// block down to it. The upper halves split off go to their order's list.
+static void* buddy_alloc(Arena* arena, size_t size, size_t alignment) {
+    // Blocks are aligned to their size relative to the arena base, so an alignment the base lacks
+    // can't be served by this arena
+    if (size > arena->size || (uintptr_t)arena->base % (alignment ? alignment : 1) != 0) {
+        return NULL;
+    }
+    size_t order = buddy_order(arena, size > alignment ? size : alignment);
+    uint64_t orders = order < BUDDY_ORDERS ? arena->bin_bitmap[0] & (~(uint64_t)0 << order) : 0;
+    if (orders == 0) {
+        return NULL;
+    }
+    arena->block_count++;
+    size_t found = __builtin_ctzll(orders);
+    size_t offset = (uintptr_t)arena->buddy_lists[found] - (uintptr_t)arena->base;
+    buddy_unlink(arena, offset, found);
+    while (found > order) {
+        found--;
+        buddy_push(arena, offset + ((size_t)1 << found), found); // Upper half stays free
+    }
+    arena->buddy_orders[offset >> arena->buddy_min_order] = order + 1;
+    void* memory = (void*)((uintptr_t)arena->base + offset);
+    size_t block_size = (size_t)1 << order;
+    class_map_set(arena->pool, memory, block_size <= TCACHE_MAX_SIZE ? block_size / TCACHE_UNIT : 0);
+    return memory;
+}
+
+// Order of the allocated block at ptr, 0 if no allocated block starts there
+static size_t buddy_order_of(Arena* arena, void* ptr) {
+    size_t offset = (uintptr_t)ptr - (uintptr_t)arena->base;
+    if (ptr == NULL || offset >= arena->size || offset % ((size_t)1 << arena->buddy_min_order) != 0) {
+        return 0;
+    }
+    uint8_t entry = arena->buddy_orders[offset >> arena->buddy_min_order];
+    return entry > 0 ? entry - 1 : 0;
+}
+
+static void buddy_free(Arena* arena, void* ptr) {
+    size_t order = buddy_order_of(arena, ptr);
+    if (order > 0) {
+        size_t offset = (uintptr_t)ptr - (uintptr_t)arena->base;
+        class_map_set(arena->pool, ptr, 0);
+        arena->buddy_orders[offset >> arena->buddy_min_order] = 0;
+        arena->block_count--;
+        buddy_release(arena, offset, order);
+    }
+}
+
+// Sets the order of the block at offset, with the class map entry that goes with it
+static void buddy_set_order(Arena* arena, size_t offset, size_t order) {
+    arena->buddy_orders[offset >> arena->buddy_min_order] = order + 1;
+    size_t block_size = (size_t)1 << order;
+    class_map_set(arena->pool, (void*)((uintptr_t)arena->base + offset),
+                  block_size <= TCACHE_MAX_SIZE ? block_size / TCACHE_UNIT : 0);
+}
+
+// Grows the block at offset to order in place if it is the lower half at every level up to
+// there and each upper half is free. Returns false, changing nothing, otherwise.
+static bool buddy_grow(Arena* arena, size_t offset, size_t from, size_t order) {
+    for (size_t k = from; k < order; k++) {
+        size_t buddy = offset + ((size_t)1 << k);
+        if (offset % ((size_t)1 << (k + 1)) != 0 || buddy + ((size_t)1 << k) > arena->size || !buddy_is_free(arena, buddy, k)) {
+            return false;
+        }
+    }
+    for (size_t k = from; k < order; k++) {
+        buddy_unlink(arena, offset + ((size_t)1 << k), k);
+    }
+    buddy_set_order(arena, offset, order);
+    return true;
+}
+
+// Shrinking splits the upper halves off in place, growth takes free upper buddies in place or
+// moves the block within the arena. *old_size is 0 if ptr is not an allocation of the arena.
+static void* buddy_resize(Arena* arena, void* ptr, size_t size, size_t* old_size) {
+    size_t from = buddy_order_of(arena, ptr);
+    *old_size = from > 0 ? (size_t)1 << from : 0;
+    if (from == 0) {
+        return NULL;
+    }
+    size_t offset = (uintptr_t)ptr - (uintptr_t)arena->base;
+    size_t order = buddy_order(arena, size);
+    if (order <= from) {
+        for (size_t k = from; k > order; k--) {
+            buddy_push(arena, offset + ((size_t)1 << (k - 1)), k - 1); // Its buddy is kept, nothing to merge
+        }
+        buddy_set_order(arena, offset, order);
+        resize_count(arena->pool, RESIZE_IN_PLACE);
+        return ptr;
+    }
+    if (buddy_grow(arena, offset, from, order)) {
+        resize_count(arena->pool, RESIZE_FORWARD);
+        return ptr;
+    }
+    void* new_memory = buddy_alloc(arena, size, 0);
+    if (new_memory) {
+        memcpy(new_memory, ptr, *old_size);
+        buddy_free(arena, ptr);
+        resize_count(arena->pool, RESIZE_RELOCATED);
+    }
+    return new_memory;
+}
+
+// Bytes of the block starting at offset, 0 past the last block. Used to walk the arena.
+static size_t buddy_block_at(Arena* arena, size_t offset, bool* is_free) {
+    if (offset >= arena->size) {
+        return 0;
+    }
+    *is_free = false;
+    size_t order = buddy_order_of(arena, (void*)((uintptr_t)arena->base + offset));
+    size_t size = order > 0 ? (size_t)1 << order : 0;
+    for (size_t k = BUDDY_ORDERS; size == 0 && k > arena->buddy_min_order; k--) {
+        if (arena->buddy_bits[k - 1] != NULL && offset % ((size_t)1 << (k - 1)) == 0 && buddy_is_free(arena, offset, k - 1)) {
+            *is_free = true;
+            size = (size_t)1 << (k - 1);
+        }
+    }
+    return size;
+}
+
+// Covers the arena with the largest aligned blocks that fit, a tail below the smallest block is unused
+static void buddy_init(Arena* arena) {
+    size_t min_order = arena->pool->block_align > 1 ? floor_log2(arena->pool->block_align) : 0;
+    arena->buddy_min_order = min_order > BUDDY_MIN_ORDER ? min_order : BUDDY_MIN_ORDER;
+    arena->buddy_orders = calloc((arena->size >> arena->buddy_min_order) + 1, 1);
+    if (!arena->buddy_orders) {
+        printf("Failed to allocate buddy order map\n");
+        exit(1);
+    }
+    size_t max_order = arena->size > 0 ? floor_log2(arena->size) : 0;
+    for (size_t order = arena->buddy_min_order; order <= max_order; order++) {
+        arena->buddy_bits[order] = calloc((arena->size >> order) / 64 + 1, sizeof(uint64_t));
+        if (!arena->buddy_bits[order]) {
+            printf("Failed to allocate buddy bitmap\n");
+            exit(1);
+        }
+    }
+
+    size_t offset = 0;
+    while (arena->size - offset >= ((size_t)1 << arena->buddy_min_order)) {
+        size_t order = floor_log2(arena->size - offset);
+        if (offset != 0 && (size_t)__builtin_ctzl(offset) < order) {
+            order = __builtin_ctzl(offset);
+        }
+        buddy_push(arena, offset, order);
+        offset += (size_t)1 << order;
+    }
+}
+
+static bool pool_commit(void* start, size_t length) {
+    return mprotect(start, length, PROT_READ | PROT_WRITE) == 0;
+}
+
+static void pool_release(void* start, size_t length) {
+    madvise(start, length, MADV_DONTNEED); // Drops the pages, the reservation stays
+    mprotect(start, length, PROT_NONE);
+}
+
+// End of the boundary-tag heap for the arena's current size, see tag_init
+static TagBlock* tag_heap_end(Arena* arena) {
+    uintptr_t start = (uintptr_t)arena->tag_first;
+    uintptr_t arena_end = (uintptr_t)arena->base + arena->size;
+    size_t block_align = arena->pool->block_align;
+    return (TagBlock*)(start + (arena_end - start - TAG_OVERHEAD) / block_align * block_align);
+}
+
+// Commits at least size more bytes at the end of the arena and hands them to the engine as a
+// free block, merged with a free last block. Called with the arena lock held.
+static bool arena_grow(Arena* arena, size_t size) {
+    mem_pool_t* pool = arena->pool;
+    size_t grow = size > pool->grow_chunk ? size : pool->grow_chunk;
+    grow = (grow + pool->page_size - 1) / pool->page_size * pool->page_size;
+    if (grow > pool->arena_slice - arena->size) {
+        grow = pool->arena_slice - arena->size; // Whatever is left of the reservation
+    }
+    if (grow == 0 || !pool_commit((void*)((uintptr_t)arena->base + arena->size), grow)) {
+        return false;
+    }
+    arena->size += grow;
+
+    if (pool->engine == MEM_ENGINE_BUMP) {
+        return true; // The top simply has more room
+    }
+    if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        // The old epilogue becomes the header of the new memory, which is then freed like any block
+        TagBlock* block = arena->tag_end;
+        TagBlock* end = tag_heap_end(arena);
+        block->header = ((uintptr_t)end - (uintptr_t)block) | (block->header & TAG_PREV_FREE);
+        end->header = 0;
+        __atomic_store_n(&arena->tag_end, end, __ATOMIC_RELAXED);
+        arena->block_count++; // Freed below like an allocated block
+        tag_free(arena, block);
+        return true;
+    }
+
+    Block* last = arena->block_last;
+    if (last->free) {
+        bin_remove(arena, last);
+        last->size += grow;
+        bin_insert(arena, last);
+        return true;
+    }
+    Block* block = malloc(sizeof(Block));
+    if (!block) {
+        printf("Failed to allocate new block metadata\n");
+        pthread_mutex_unlock(&arena->mutex); // Unlock before exit
+        exit(1);
+    }
+    block->size = grow;
+    block->free = true;
+    block->memory = (void*)((uintptr_t)last->memory + last->size);
+    block->next = NULL;
+    block->prev = last;
+    last->next = block;
+    arena->block_last = block;
+    bin_insert(arena, block);
+    return true;
+}
+
+// Returns the free end of the arena to the system once it exceeds the high watermark, keeping
+// low_watermark bytes of it committed. Called with the arena lock held.
+static void arena_trim(Arena* arena) {
+    mem_pool_t* pool = arena->pool;
+    size_t tail;
+    size_t keep = pool->low_watermark;
+    if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        if (!(arena->tag_end->header & TAG_PREV_FREE)) {
+            return;
+        }
+        tail = *(size_t*)((uintptr_t)arena->tag_end - sizeof(size_t)); // Footer of the last block
+        if (keep < TAG_MIN_BLOCK + pool->block_align) {
+            keep = TAG_MIN_BLOCK + pool->block_align; // The last block stays a block
+        }
+    } else if (pool->engine == MEM_ENGINE_BUMP) {
+        tail = (uintptr_t)arena->base + arena->size - (uintptr_t)arena->bump_top;
+    } else {
+        if (!arena->block_last->free) {
+            return;
+        }
+        tail = arena->block_last->size;
+    }
+    if (tail <= pool->high_watermark || tail <= keep) {
+        return;
+    }
+
+    size_t release = (tail - keep) / pool->page_size * pool->page_size;
+    if (release > arena->size - arena->min_size) {
+        release = arena->size - arena->min_size;
+    }
+    if (release == 0) {
+        return;
+    }
+
+    if (pool->engine == MEM_ENGINE_BUMP) {
+        arena->size -= release;
+    } else if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        TagBlock* last = (TagBlock*)((uintptr_t)arena->tag_end - tail);
+        tag_bin_remove(arena, last);
+        arena->size -= release;
+        TagBlock* end = tag_heap_end(arena);
+        end->header = 0;
+        __atomic_store_n(&arena->tag_end, end, __ATOMIC_RELAXED);
+        tag_make_free(arena, last, (uintptr_t)end - (uintptr_t)last);
+    } else {
+        Block* last = arena->block_last;
+        bin_remove(arena, last);
+        arena->size -= release;
+        last->size -= release;
+        if (last->size > 0) {
+            bin_insert(arena, last);
+        } else {
+            last->prev->next = NULL;
+            block_absorbed(arena, last, last->prev);
+            free(last);
+        }
+    }
+    pool_release((void*)((uintptr_t)arena->base + arena->size), release);
+}
+
+// Bytes of the arena taken by allocated blocks and engine overhead
+static size_t arena_in_use(Arena* arena) {
+    switch (arena->pool->engine) {
+    case MEM_ENGINE_BUMP:
+        return arena->bump_top - (char*)arena->base;
+    default:
+        return arena->size - arena->free_bytes;
+    }
+}
+
+static size_t arena_free(Arena* arena) {
+    switch (arena->pool->engine) {
+    case MEM_ENGINE_BUMP:
+        return (uintptr_t)arena->base + arena->size - (uintptr_t)arena->bump_top;
+    default:
+        return arena->free_bytes;
+    }
+}
+
+// Only the largest non-empty bin has to be scanned, or the rightmost path of the size tree
+static size_t arena_largest_free(Arena* arena) {
+    mem_pool_t* pool = arena->pool;
+    if (pool->engine == MEM_ENGINE_BUMP) {
+        return arena_free(arena);
+    }
+    if (pool->engine == MEM_ENGINE_BUDDY) {
+        if (arena->bin_bitmap[0] == 0) {
+            return 0;
+        }
+        return (size_t)1 << floor_log2(arena->bin_bitmap[0]);
+    }
+    if (pool->placement == MEM_FIT_ADDRESS_BEST) {
+        void* node = arena->size_tree;
+        while (node != NULL && tree_child(arena, node, 1) != NULL) {
+            node = tree_child(arena, node, 1);
+        }
+        return node ? tree_size(arena, node) : 0;
+    }
+    size_t largest = 0;
+    for (size_t word = BIN_WORDS; word > 0 && largest == 0; word--) {
+        uint64_t bits = arena->bin_bitmap[word - 1];
+        if (bits == 0) {
+            continue;
+        }
+        size_t bin = (word - 1) * 64 + floor_log2(bits);
+        if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+            for (TagBlock* block = arena->tag_bins[bin]; block != NULL; block = block->bin_next) {
+                largest = tag_size(block) > largest ? tag_size(block) : largest;
+            }
+        } else {
+            for (Block* block = arena->free_bins[bin]; block != NULL; block = block->bin_next) {
+                largest = block->size > largest ? block->size : largest;
+            }
+        }
+    }
+    return largest;
+}
+
+// Lock profiling. The counters of a site sit on their own cache line and are updated
+// atomically, they are only touched while profiling is enabled.
+typedef struct {
+    mem_lock_stats_t stats;
+} __attribute__((aligned(MEM_CACHE_LINE))) LockSite;
+
+static LockSite lock_sites[MEM_LOCK_SITES];
+static int lock_profiling = 0;
+static __thread uint64_t lock_held_since[MEM_LOCK_SITES]; // Acquisition time of the outermost lock held at each site
+static __thread uint32_t lock_depth[MEM_LOCK_SITES];      // Locks the thread holds at each site
+
+static uint64_t now_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static void atomic_max(uint64_t* target, uint64_t value) {
+    uint64_t current = __atomic_load_n(target, __ATOMIC_RELAXED);
+    while (value > current &&
+           !__atomic_compare_exchange_n(target, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void lock_site_acquired(mem_lock_site_t site, bool contended, uint64_t wait_ns) {
+    mem_lock_stats_t* stats = &lock_sites[site].stats;
+    __atomic_fetch_add(&stats->acquisitions, 1, __ATOMIC_RELAXED);
+    if (contended) {
+        __atomic_fetch_add(&stats->contended, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stats->wait_ns, wait_ns, __ATOMIC_RELAXED);
+        atomic_max(&stats->max_wait_ns, wait_ns);
+    }
+    if (lock_depth[site]++ == 0) {
+        lock_held_since[site] = now_ns();
+    }
+}
+
+static void lock_site_released(mem_lock_site_t site) {
+    if (lock_depth[site] == 0 || --lock_depth[site] > 0) {
+        return; // Taken before profiling was enabled, or an outer lock of the site is still held
+    }
+    uint64_t held = now_ns() - lock_held_since[site];
+    __atomic_fetch_add(&lock_sites[site].stats.hold_ns, held, __ATOMIC_RELAXED);
+    atomic_max(&lock_sites[site].stats.max_hold_ns, held);
+}
+
+static bool lock_profiled(void) {
+    return __atomic_load_n(&lock_profiling, __ATOMIC_RELAXED);
+}
+
+// Arena locks are taken through these two so mem_stats can report lock waits and peak usage.
+// The clock is only read when the lock is already taken, or when lock profiling is enabled.
+static void arena_lock(Arena* arena, mem_lock_site_t site) {
+    bool contended = pthread_mutex_trylock(&arena->mutex) != 0;
+    uint64_t wait_ns = 0;
+    if (contended) {
+        uint64_t start = now_ns();
+        pthread_mutex_lock(&arena->mutex);
+        wait_ns = now_ns() - start;
+        arena->lock_waits++;
+        arena->lock_wait_ns += wait_ns;
+    }
+    if (lock_profiled()) {
+        lock_site_acquired(site, contended, wait_ns);
+    }
+}
+
+static void arena_unlock(Arena* arena, mem_lock_site_t site) {
+    size_t in_use = arena_in_use(arena);
+    if (in_use > arena->peak_in_use) {
+        arena->peak_in_use = in_use;
+    }
+    if (lock_profiled()) {
+        lock_site_released(site);
+    }
+    pthread_mutex_unlock(&arena->mutex);
+}
+
+void mem_lock_profile(int enable) {
+    if (enable) {
+        memset(lock_sites, 0, sizeof(lock_sites));
+    }
+    __atomic_store_n(&lock_profiling, enable != 0, __ATOMIC_RELAXED);
+}
+
+void mem_lock_acquire(pthread_mutex_t* mutex, mem_lock_site_t site) {
+    if (!lock_profiled()) {
+        pthread_mutex_lock(mutex);
+        return;
+    }
+    bool contended = pthread_mutex_trylock(mutex) != 0;
+    uint64_t wait_ns = 0;
+    if (contended) {
+        uint64_t start = now_ns();
+        pthread_mutex_lock(mutex);
+        wait_ns = now_ns() - start;
+    }
+    lock_site_acquired(site, contended, wait_ns);
+}
+
+void mem_lock_release(pthread_mutex_t* mutex, mem_lock_site_t site) {
+    if (lock_profiled()) {
+        lock_site_released(site);
+    }
+    pthread_mutex_unlock(mutex);
+}
+
+mem_lock_stats_t mem_lock_stats(mem_lock_site_t site) {
+    mem_lock_stats_t stats = {0};
+    if (site < MEM_LOCK_SITES) {
+        mem_lock_stats_t* counters = &lock_sites[site].stats;
+        stats.acquisitions = __atomic_load_n(&counters->acquisitions, __ATOMIC_RELAXED);
+        stats.contended = __atomic_load_n(&counters->contended, __ATOMIC_RELAXED);
+        stats.wait_ns = __atomic_load_n(&counters->wait_ns, __ATOMIC_RELAXED);
+        stats.max_wait_ns = __atomic_load_n(&counters->max_wait_ns, __ATOMIC_RELAXED);
+        stats.hold_ns = __atomic_load_n(&counters->hold_ns, __ATOMIC_RELAXED);
+        stats.max_hold_ns = __atomic_load_n(&counters->max_hold_ns, __ATOMIC_RELAXED);
+    }
+    return stats;
+}
+
+static const char* lock_site_names[MEM_LOCK_SITES] = {
+    "alloc", "free", "resize", "reset", "list_insert", "list_delete", "list_read",
+};
+
+// Appends text at length, truncating so the buffer stays NUL-terminated. Returns the new length.
+static size_t lock_dump_append(char* buffer, size_t capacity, size_t length, const char* text) {
+    while (*text != '\0' && length + 1 < capacity) {
+        buffer[length++] = *text++;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
+// Decimal digits of value by hand, snprintf is not async-signal-safe
+static size_t lock_dump_number(char* buffer, size_t capacity, size_t length, uint64_t value) {
+    char digits[21];
+    size_t start = sizeof(digits) - 1;
+    digits[start] = '\0';
+    do {
+        digits[--start] = '0' + value % 10;
+        value /= 10;
+    } while (value != 0);
+    return lock_dump_append(buffer, capacity, length, digits + start);
+}
+
+// Formats into a caller-provided buffer with atomic loads, plain stores and no library calls, so
+// the signal handler can use it too. capacity must be at least 1.
+static size_t lock_dump_format(char* buffer, size_t capacity) {
+    static const char* fields[] = {
+        "\"acquisitions\": ", ", \"contended\": ", ", \"wait_ns\": ",
+        ", \"max_wait_ns\": ", ", \"hold_ns\": ", ", \"max_hold_ns\": ",
+    };
+    size_t length = 0;
+    buffer[0] = '\0';
+    for (int site = 0; site < MEM_LOCK_SITES; site++) {
+        mem_lock_stats_t stats = mem_lock_stats(site);
+        uint64_t values[] = {stats.acquisitions, stats.contended, stats.wait_ns,
+                             stats.max_wait_ns, stats.hold_ns, stats.max_hold_ns};
+        length = lock_dump_append(buffer, capacity, length, site == 0 ? "{\"" : ", \"");
+        length = lock_dump_append(buffer, capacity, length, lock_site_names[site]);
+        length = lock_dump_append(buffer, capacity, length, "\": {");
+        for (size_t field = 0; field < sizeof(values) / sizeof(values[0]); field++) {
+            length = lock_dump_append(buffer, capacity, length, fields[field]);
+            length = lock_dump_number(buffer, capacity, length, values[field]);
+        }
+        length = lock_dump_append(buffer, capacity, length, "}");
+    }
+    return lock_dump_append(buffer, capacity, length, "}\n");
+}
+
+#define LOCK_DUMP_CAPACITY 2048
+
+void mem_lock_dump(FILE* out) {
+    char buffer[LOCK_DUMP_CAPACITY];
+    lock_dump_format(buffer, sizeof(buffer));
+    fputs(buffer, out);
+}
+
+static void lock_dump_stderr(void) {
+    char buffer[LOCK_DUMP_CAPACITY];
+    size_t length = lock_dump_format(buffer, sizeof(buffer));
+    if (write(STDERR_FILENO, buffer, length) < 0) {
+        return; // Nothing left to report it to
+    }
+}
+
+static void lock_dump_signal(int signal) {
+    (void)signal;
+    lock_dump_stderr();
+}
+
+void mem_lock_dump_at_exit(int signal) {
+    static bool registered = false;
+    if (!registered) {
+        registered = true;
+        atexit(lock_dump_stderr);
+    }
+    if (signal != 0) {
+        struct sigaction action = {0};
+        action.sa_handler = lock_dump_signal;
+        action.sa_flags = SA_RESTART;
+        sigemptyset(&action.sa_mask);
+        sigaction(signal, &action, NULL);
+    }
+}
+
+// Engine dispatch, called with the arena lock held. Memory is not zeroed here.
+static void* pool_alloc(Arena* arena, size_t size) {
+    switch (arena->pool->engine) {
+    case MEM_ENGINE_BOUNDARY_TAG:
+        return tag_alloc(arena, size);
+    case MEM_ENGINE_BUMP:
+        return bump_alloc(arena, size, 0);
+    case MEM_ENGINE_BUDDY:
+        return buddy_alloc(arena, size, 0);
+    default:
+        return list_alloc(arena, size);
+    }
+}
+
+static void* pool_alloc_aligned(Arena* arena, size_t size, size_t alignment) {
+    switch (arena->pool->engine) {
+    case MEM_ENGINE_BOUNDARY_TAG:
+        return tag_alloc_aligned(arena, size, alignment);
+    case MEM_ENGINE_BUMP:
+        return bump_alloc(arena, size, alignment);
+    case MEM_ENGINE_BUDDY:
+        return buddy_alloc(arena, size, alignment);
+    default:
+        return list_alloc_aligned(arena, size, alignment);
+    }
+}
+
+static void pool_free_block(Arena* arena, void* block) {
+    switch (arena->pool->engine) {
+    case MEM_ENGINE_BOUNDARY_TAG: {
+        TagBlock* tag = tag_lookup(arena, block);
+        if (tag) {
+            tag_free(arena, tag);
+        }
+        break;
+    }
+    case MEM_ENGINE_BUMP:
+        bump_free(arena, block);
+        break;
+    case MEM_ENGINE_BUDDY:
+        buddy_free(arena, block);
+        break;
+    default: {
+        Block* current = index_find(arena, block);
+        if (current) {
+            list_free(arena, current);
+        }
+        break;
+    }
+    }
+}
+
+// Hands out up to count blocks, consecutive in memory where the engine allows. Called with
+// the arena lock held, memory is not zeroed here.
+static size_t pool_alloc_run(Arena* arena, size_t size, size_t count, void** out) {
+    switch (arena->pool->engine) {
+    case MEM_ENGINE_BOUNDARY_TAG:
+        return tag_alloc_run(arena, size, count, out);
+    case MEM_ENGINE_BLOCK_LIST:
+        return list_alloc_run(arena, size, count, out);
+    default: {
+        size_t n = 0;
+        while (n < count && (out[n] = pool_alloc(arena, size)) != NULL) {
+            n++;
+        }
+        return n;
+    }
+    }
+}
+
+// Frees blocks[0], and with the block-list engine the adjacent blocks after it in one merge.
+// Returns how many entries of the sorted blocks were consumed.
+static size_t pool_free_run(Arena* arena, void** blocks, size_t count) {
+    if (arena->pool->engine == MEM_ENGINE_BLOCK_LIST) {
+        return list_free_run(arena, blocks, count);
+    }
+    pool_free_block(arena, blocks[0]);
+    return 1;
+}
+
+static void pool_free(Arena* arena, void* block) {
+    pool_free_block(arena, block);
+    if (arena->pool->growable) {
+        arena_trim(arena);
+    }
+}
+
+// Arena whose slice contains ptr, NULL if ptr is not inside the pool
+static Arena* arena_of(mem_pool_t* pool, void* ptr) {
+    uintptr_t offset = (uintptr_t)ptr - (uintptr_t)pool->memory;
+    if (ptr == NULL || offset >= pool->size) {
+        return NULL;
+    }
+    size_t index = offset / pool->arena_slice;
+    return &pool->arenas[index < pool->arena_count ? index : pool->arena_count - 1];
+}
+
+// Index of the arena the calling thread allocates from
+static size_t thread_arena(mem_pool_t* pool) {
+    if (pool->arena_count == 1) {
+        return 0;
+    }
+    if (pool->arena_affinity == MEM_ARENA_CPU) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0) {
+            return (size_t)cpu % pool->arena_count;
+        }
+    }
+    if (arena_ticket == 0) {
+        arena_ticket = __atomic_add_fetch(&arena_next_ticket, 1, __ATOMIC_RELAXED);
+    }
+    return (arena_ticket - 1) % pool->arena_count;
+}
+
+// Allocates from the thread's arena and falls back to the other arenas when it is exhausted.
+// An alignment of 0 asks for no more than the engine guarantees anyway.
+static void* arenas_alloc(mem_pool_t* pool, size_t size, size_t alignment) {
+    size_t home = thread_arena(pool);
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        Arena* arena = &pool->arenas[(home + i) % pool->arena_count];
+        arena_lock(arena, MEM_LOCK_ALLOC); // Lock helps to prevent multiple threads from allocating memory
+        void* allocated_memory = alignment ? pool_alloc_aligned(arena, size, alignment) : pool_alloc(arena, size);
+        if (allocated_memory && pool->zero_in_lock) {
+            memset(allocated_memory, 0, size);
+        }
+        arena_unlock(arena, MEM_LOCK_ALLOC); // Unlock before return
+        if (allocated_memory) {
+            return allocated_memory;
+        }
+    }
+
+    // Every arena is full: commit more memory, to the home arena first
+    for (size_t i = 0; pool->growable && i < pool->arena_count; i++) {
+        Arena* arena = &pool->arenas[(home + i) % pool->arena_count];
+        arena_lock(arena, MEM_LOCK_ALLOC);
+        void* allocated_memory = NULL;
+        // Room for the block itself, an alignment gap and the engine's per-block overhead
+        if (arena_grow(arena, size + alignment + TAG_MIN_BLOCK + pool->block_align)) {
+            allocated_memory = alignment ? pool_alloc_aligned(arena, size, alignment) : pool_alloc(arena, size);
+        }
+        if (allocated_memory && pool->zero_in_lock) {
+            memset(allocated_memory, 0, size);
+        }
+        arena_unlock(arena, MEM_LOCK_ALLOC);
+        if (allocated_memory) {
+            return allocated_memory;
+        }
+    }
+    return NULL;
+}
+
+// Counters read by other threads are bumped with a relaxed store instead of an atomic add,
+// the owning thread is the only writer.
+static void counter_bump(uint64_t* counter) {
+    __atomic_store_n(counter, *counter + 1, __ATOMIC_RELAXED);
+}
+
+// Marks a block entering a thread cache, so freeing it again is caught until it is handed out
+static void tcache_mark_cached(mem_pool_t* pool, void* block) {
+    if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        TagBlock* tag = (TagBlock*)((uintptr_t)block - TAG_OVERHEAD);
+        __atomic_fetch_or(&tag->header, TAG_CACHED, __ATOMIC_RELAXED); // Neighbours update TAG_PREV_FREE
+    } else {
+        class_map_set(pool, block, TCACHE_PARKED);
+    }
+}
+
+// Undoes tcache_mark_cached for a block of class units - 1 leaving the cache
+static void tcache_mark_allocated(mem_pool_t* pool, void* block, size_t units) {
+    if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        TagBlock* tag = (TagBlock*)((uintptr_t)block - TAG_OVERHEAD);
+        __atomic_fetch_and(&tag->header, ~TAG_CACHED, __ATOMIC_RELAXED);
+    } else {
+        class_map_set(pool, block, units);
+    }
+}
+
+// Returns cached blocks of class cls to their arenas until keep are left. Consecutive
+// blocks of the same arena are freed under a single acquisition of its lock.
+static void tcache_release(ThreadCache* cache, size_t cls, size_t keep) {
+    Arena* locked = NULL;
+    while (cache->counts[cls] > keep) {
+        void* block = cache->heads[cls];
+        cache->heads[cls] = *(void**)block;
+        cache->counts[cls]--;
+        tcache_mark_allocated(cache->pool, block, cls + 1);
+
+        Arena* arena = arena_of(cache->pool, block);
+        if (arena != locked) {
+            if (locked) {
+                arena_unlock(locked, MEM_LOCK_FREE);
+            }
+            arena_lock(arena, MEM_LOCK_FREE);
+            locked = arena;
+        }
+        pool_free(arena, block);
+    }
+    if (locked) {
+        arena_unlock(locked, MEM_LOCK_FREE);
+    }
+}
+
+static void tcache_release_all(ThreadCache* cache) {
+    for (size_t cls = 0; cls < TCACHE_CLASSES; cls++) {
+        tcache_release(cache, cls, 0);
+    }
+}
+
+// Thread exit: hand the cached blocks back and retire the counters
+static void tcache_destroy(void* arg) {
+    ThreadCache* cache = arg;
+    mem_pool_t* pool = cache->pool;
+    tcache_release_all(cache);
+    pthread_mutex_lock(&pool->mutex);
+    pool->tcache_retired_hits += cache->hits;
+    pool->tcache_retired_misses += cache->misses;
+    for (int kind = 0; kind < CALL_KINDS; kind++) {
+        pool->retired_calls[kind] += cache->calls[kind];
+    }
+    if (cache->prev) {
+        cache->prev->next = cache->next;
+    } else {
+        pool->tcache_registry = cache->next;
+    }
+    if (cache->next) {
+        cache->next->prev = cache->prev;
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    free(cache);
+}
+
+static ThreadCache* tcache_get(mem_pool_t* pool) {
+    ThreadCache* cache = pthread_getspecific(pool->tcache_key);
+    if (cache == NULL) {
+        cache = calloc(1, sizeof(ThreadCache));
+        if (!cache) {
+            printf("Failed to allocate thread cache\n");
+            exit(1);
+        }
+        cache->pool = pool;
+        pthread_mutex_lock(&pool->mutex);
+        cache->next = pool->tcache_registry;
+        if (pool->tcache_registry) {
+            pool->tcache_registry->prev = cache;
+        }
+        pool->tcache_registry = cache;
+        pthread_mutex_unlock(&pool->mutex);
+        pthread_setspecific(pool->tcache_key, cache);
+    }
+    return cache;
+}
+
+// Cache class + 1 of an allocated block, 0 if it is too large (or not ours) to be cached.
+// Reads only state that is stable while the block is allocated, so no lock is needed. A freed
+// block yields 0 as well, a second free of it goes to the engine, which ignores it. A block
+// that is already cached yields TCACHE_PARKED.
+static size_t tcache_units_of(mem_pool_t* pool, void* block) {
+    Arena* arena = arena_of(pool, block);
+    if (arena == NULL) {
+        return 0;
+    }
+    if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+        TagBlock* tag = (TagBlock*)((uintptr_t)block - TAG_OVERHEAD);
+        if (tag < arena->tag_first || tag >= __atomic_load_n(&arena->tag_end, __ATOMIC_RELAXED)) {
+            return 0;
+        }
+        size_t header = __atomic_load_n(&tag->header, __ATOMIC_RELAXED);
+        if (header & (TAG_FREE | TAG_CACHED)) {
+            return (header & TAG_CACHED) ? TCACHE_PARKED : 0;
+        }
+        size_t units = ((header & ~TAG_FLAGS) - TAG_OVERHEAD) / TCACHE_UNIT;
+        return units <= TCACHE_CLASSES ? units : 0;
+    }
+    uintptr_t offset = (uintptr_t)block - (uintptr_t)pool->memory;
+    return offset % TCACHE_UNIT == 0 ? pool->class_map[offset / TCACHE_UNIT] : 0;
+}
+
+static void* tcache_alloc(mem_pool_t* pool, size_t size) {
+    size_t units = size == 0 ? 1 : (size + TCACHE_UNIT - 1) / TCACHE_UNIT;
+    size_t cls = units - 1;
+    ThreadCache* cache = tcache_get(pool);
+
+    void* block = cache->heads[cls];
+    if (block != NULL) {
+        cache->heads[cls] = *(void**)block;
+        cache->counts[cls]--;
+        tcache_mark_allocated(pool, block, units);
+        counter_bump(&cache->hits);
+        return block;
+    }
+
+    // Miss: take the arena lock once and bring in a batch of blocks of this class
+    counter_bump(&cache->misses);
+    Arena* arena = &pool->arenas[thread_arena(pool)];
+    arena_lock(arena, MEM_LOCK_ALLOC);
+    block = pool_alloc(arena, units * TCACHE_UNIT);
+    if (block != NULL) {
+        size_t batch = pool->tcache_depth / 2 > 0 ? pool->tcache_depth / 2 : 1;
+        while (cache->counts[cls] < batch) {
+            void* extra = pool_alloc(arena, units * TCACHE_UNIT);
+            if (extra == NULL) {
+                break;
+            }
+            tcache_mark_cached(pool, extra);
+            *(void**)extra = cache->heads[cls];
+            cache->heads[cls] = extra;
+            cache->counts[cls]++;
+        }
+        __atomic_fetch_add(&pool->tcache_refills, 1, __ATOMIC_RELAXED);
+    }
+    arena_unlock(arena, MEM_LOCK_ALLOC);
+
+    if (block == NULL) {
+        block = arenas_alloc(pool, units * TCACHE_UNIT, 0);
+    }
+    if (block == NULL) {
+        // Memory parked in our own cache may be exactly what is missing
+        tcache_release_all(cache);
+        block = arenas_alloc(pool, units * TCACHE_UNIT, 0);
+    }
+    return block;
+}
+
+// Returns false if the block has to go back to its arena directly
+static bool tcache_free(mem_pool_t* pool, void* block) {
+    size_t units = tcache_units_of(pool, block);
+    if (units == TCACHE_PARKED) {
+        return true; // Freed again while cached, ignored like a second free in the engines
+    }
+    if (units == 0) {
+        return false;
+    }
+    size_t cls = units - 1;
+    ThreadCache* cache = tcache_get(pool);
+    if (cache->counts[cls] >= pool->tcache_depth) {
+        // Full: flush half of the class in one critical section per arena
+        tcache_release(cache, cls, pool->tcache_depth / 2);
+        __atomic_fetch_add(&pool->tcache_flushes, 1, __ATOMIC_RELAXED);
+    }
+
+    tcache_mark_cached(pool, block);
+    *(void**)block = cache->heads[cls];
+    cache->heads[cls] = block;
+    cache->counts[cls]++;
+    return true;
+}
+
+mem_tcache_stats_t mem_pool_tcache_stats(mem_pool_t* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    mem_tcache_stats_t stats = {
+        .hits = pool->tcache_retired_hits,
+        .misses = pool->tcache_retired_misses,
+        .refills = __atomic_load_n(&pool->tcache_refills, __ATOMIC_RELAXED),
+        .flushes = __atomic_load_n(&pool->tcache_flushes, __ATOMIC_RELAXED),
+    };
+    for (ThreadCache* cache = pool->tcache_registry; cache != NULL; cache = cache->next) {
+        stats.hits += __atomic_load_n(&cache->hits, __ATOMIC_RELAXED);
+        stats.misses += __atomic_load_n(&cache->misses, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return stats;
+}
+
+// Only reads counters: each arena's lock is held just long enough to copy them, plus a scan of
+// its largest bin for the largest free block
+mem_stats_t mem_pool_stats(mem_pool_t* pool) {
+    mem_stats_t stats = {0};
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        Arena* arena = &pool->arenas[i];
+        pthread_mutex_lock(&arena->mutex);
+        size_t largest = arena_largest_free(arena);
+        stats.in_use += arena_in_use(arena);
+        stats.peak_in_use += arena->peak_in_use;
+        stats.free += arena_free(arena);
+        stats.largest_free = largest > stats.largest_free ? largest : stats.largest_free;
+        stats.blocks += pool->engine == MEM_ENGINE_BLOCK_LIST ? arena->block_index_count : arena->block_count;
+        stats.lock_waits += arena->lock_waits;
+        stats.lock_wait_ns += arena->lock_wait_ns;
+        pthread_mutex_unlock(&arena->mutex);
+    }
+
+    uint64_t calls[CALL_KINDS];
+    pthread_mutex_lock(&pool->mutex);
+    memcpy(calls, pool->retired_calls, sizeof(calls));
+    for (ThreadCache* cache = pool->tcache_registry; cache != NULL; cache = cache->next) {
+        for (int kind = 0; kind < CALL_KINDS; kind++) {
+            calls[kind] += __atomic_load_n(&cache->calls[kind], __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    stats.allocs = calls[CALL_ALLOC];
+    stats.frees = calls[CALL_FREE];
+    stats.resizes = calls[CALL_RESIZE];
+    stats.failed_allocs = calls[CALL_FAILED_ALLOC];
+    return stats;
+}
+
+// Built from the histograms the engines keep up to date, no block is visited
+mem_fragmentation_t mem_pool_fragmentation(mem_pool_t* pool) {
+    mem_fragmentation_t fragmentation = {0};
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        Arena* arena = &pool->arenas[i];
+        pthread_mutex_lock(&arena->mutex);
+        size_t free = arena_free(arena);
+        size_t largest = arena_largest_free(arena);
+        fragmentation.free += free;
+        fragmentation.largest_free = largest > fragmentation.largest_free ? largest : fragmentation.largest_free;
+        if (pool->engine == MEM_ENGINE_BUMP) {
+            if (free > 0) {
+                fragmentation.histogram[floor_log2(free)]++; // The space above the top
+            }
+        } else {
+            for (size_t k = 0; k < MEM_FREE_BUCKETS; k++) {
+                fragmentation.histogram[k] += arena->free_histogram[k];
+            }
+        }
+        pthread_mutex_unlock(&arena->mutex);
+    }
+    for (size_t k = 0; k < MEM_FREE_BUCKETS; k++) {
+        fragmentation.free_blocks += fragmentation.histogram[k];
+    }
+    if (fragmentation.free > 0) {
+        fragmentation.index = 1.0 - (double)fragmentation.largest_free / fragmentation.free;
+    }
+    return fragmentation;
+}
+
+// One JSON object per line, for scripts and log collectors
+void mem_pool_dump(mem_pool_t* pool, FILE* out) {
+    mem_stats_t stats = mem_pool_stats(pool);
+    mem_fragmentation_t fragmentation = mem_pool_fragmentation(pool);
+    fprintf(out, "{\"engine\": %d, \"arenas\": %zu, \"resident\": %zu, \"in_use\": %zu, \"peak_in_use\": %zu, "
+                 "\"free\": %zu, \"largest_free\": %zu, \"free_blocks\": %zu, \"fragmentation\": %.4f, "
+                 "\"blocks\": %zu, \"allocs\": %llu, \"frees\": %llu, \"resizes\": %llu, \"failed_allocs\": %llu, "
+                 "\"lock_waits\": %llu, \"lock_wait_ns\": %llu, \"free_histogram\": {",
+            (int)pool->engine, pool->arena_count, mem_pool_resident_size(pool), stats.in_use, stats.peak_in_use,
+            fragmentation.free, fragmentation.largest_free, fragmentation.free_blocks, fragmentation.index,
+            stats.blocks, (unsigned long long)stats.allocs, (unsigned long long)stats.frees,
+            (unsigned long long)stats.resizes, (unsigned long long)stats.failed_allocs,
+            (unsigned long long)stats.lock_waits, (unsigned long long)stats.lock_wait_ns);
+    const char* separator = "";
+    for (size_t k = 0; k < MEM_FREE_BUCKETS; k++) {
+        if (fragmentation.histogram[k] > 0) {
+            fprintf(out, "%s\"%zu\": %zu", separator, (size_t)1 << k, fragmentation.histogram[k]);
+            separator = ", ";
+        }
+    }
+    fprintf(out, "}}\n");
+}
+
+size_t mem_pool_resident_size(mem_pool_t* pool) {
+    size_t resident = 0;
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        pthread_mutex_lock(&pool->arenas[i].mutex);
+        resident += pool->arenas[i].size;
+        pthread_mutex_unlock(&pool->arenas[i].mutex);
+    }
+    return resident;
+}
+
+mem_pool_t* mem_pool_create(size_t size) {
+    return mem_pool_create_config(size, (mem_config_t){0});
+}
+
+mem_pool_t* mem_pool_create_config(size_t size, mem_config_t config) {
+    if ((config.alignment & (config.alignment - 1)) != 0) {
+        printf("Alignment must be a power of two\n");
+        exit(1);
+    }
+    mem_pool_t* pool = calloc(1, sizeof(mem_pool_t));
+    if (!pool) {
+        printf("Failed to allocate memory pool\n");
+        exit(1);
+    }
+    pthread_mutex_init(&pool->mutex, NULL);
+    pool->engine = config.engine;
+    pool->block_align = config.alignment > 0 ? config.alignment : 1;
+    pool->placement = config.placement;
+    if (pool->engine == MEM_ENGINE_BOUNDARY_TAG && pool->block_align < TAG_ALIGN) {
+        pool->block_align = TAG_ALIGN;
+    }
+
+    // Slices are kept 16-byte aligned for the boundary tags and the class map, and block aligned
+    size_t slice_unit = pool->block_align > TCACHE_UNIT ? pool->block_align : TCACHE_UNIT;
+    size_t initial_slice = 0;
+    pool->arena_count = config.arena_count > 0 ? config.arena_count : 1;
+    pool->growable = config.max_size > size;
+    if (pool->growable) {
+        if (pool->engine == MEM_ENGINE_BUDDY) {
+            printf("The buddy engine needs a fixed-size pool\n");
+            exit(1);
+        }
+        // Arenas grow in whole pages inside their share of max_size
+        size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+        if (pool->block_align > page_size) {
+            printf("Growable pools support alignments up to the page size\n");
+            exit(1);
+        }
+        pool->page_size = page_size;
+        slice_unit = page_size;
+        initial_slice = (size / pool->arena_count + page_size - 1) / page_size * page_size;
+        if (initial_slice == 0) {
+            initial_slice = page_size;
+        }
+        pool->arena_slice = config.max_size / pool->arena_count / page_size * page_size;
+        if (pool->arena_slice < initial_slice) {
+            pool->arena_slice = initial_slice;
+        }
+        pool->size = pool->arena_slice * pool->arena_count;
+        pool->memory = mmap(NULL, pool->size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (pool->memory == MAP_FAILED) {
+            printf("Memory reservation failed\n");
+            exit(1);
+        }
+        pool->grow_chunk = config.grow_chunk > 0 ? config.grow_chunk : 64 * 1024;
+        pool->high_watermark = config.high_watermark > 0 ? config.high_watermark : 4 * pool->grow_chunk;
+        pool->low_watermark = config.low_watermark < pool->high_watermark ? config.low_watermark : pool->high_watermark;
+    } else {
+        pool->size = size;
+        pool->arena_slice = size / pool->arena_count / slice_unit * slice_unit;
+        if (pool->arena_slice == 0) {
+            pool->arena_count = 1;
+            pool->arena_slice = size > 0 ? size : 1;
+        }
+        size_t pool_align = pool->block_align > POOL_ALIGN ? pool->block_align : POOL_ALIGN;
+        if (pool->engine == MEM_ENGINE_BUDDY) {
+            // Buddy blocks are aligned to their size relative to the arena base, so the first
+            // arena serves aligned requests up to its largest block or a page
+            size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+            size_t region_align = (size_t)1 << floor_log2(pool->arena_slice);
+            region_align = region_align < page_size ? region_align : page_size;
+            pool_align = pool_align > region_align ? pool_align : region_align;
+        }
+        if (posix_memalign(&pool->memory, pool_align, pool->size) != 0) {
+            printf("Memory allocation failed\n");
+            exit(1);
+        }
+    }
+
+    // Every thread gets a cache record for its call counters, blocks are only cached with a depth
+    pool->zero_in_lock = config.zero_in_lock != 0;
+    // Bump frees are no-ops anyway, zero_in_lock pools zero every block in arenas_alloc
+    pool->tcache_depth = pool->engine == MEM_ENGINE_BUMP || pool->zero_in_lock ? 0 : config.tcache_depth;
+    if (pthread_key_create(&pool->tcache_key, tcache_destroy) != 0) {
+        printf("Failed to create thread cache key\n");
+        exit(1);
+    }
+    if (pool->tcache_depth > 0) {
+        if (pool->engine == MEM_ENGINE_BLOCK_LIST || pool->engine == MEM_ENGINE_BUDDY) {
+            pool->class_map = calloc(pool->size / TCACHE_UNIT + 1, 1); // Pages are only touched when used
+            if (!pool->class_map) {
+                printf("Failed to allocate thread cache class map\n");
+                exit(1);
+            }
+        }
+    }
+
+    pool->arena_affinity = config.arena_affinity;
+    pool->arenas = calloc(pool->arena_count, sizeof(Arena));
+    if (!pool->arenas) {
+        printf("Failed to allocate arenas\n");
         exit(1);
     }
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        Arena* arena = &pool->arenas[i];
+        pthread_mutex_init(&arena->mutex, NULL);
+        arena->pool = pool;
+        arena->base = (void*)((uintptr_t)pool->memory + i * pool->arena_slice);
+        if (pool->growable) {
+            arena->size = initial_slice;
+            if (!pool_commit(arena->base, arena->size)) {
+                printf("Memory allocation failed\n");
+                exit(1);
+            }
+        } else {
+            arena->size = i + 1 < pool->arena_count ? pool->arena_slice : size - i * pool->arena_slice;
+        }
+
+        arena->min_size = arena->size;
+        if (pool->engine == MEM_ENGINE_BUMP) {
+            bump_init(arena);
+        } else if (pool->engine == MEM_ENGINE_BUDDY) {
+            buddy_init(arena);
+        } else if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+            tag_init(arena);
+        } else {
+            list_init(arena);
+        }
+    }
+    return pool;
+}
 
-    memory_pool_size = size;
+// Alignment every block has without asking for it
+static size_t natural_alignment(mem_pool_t* pool) {
+    if (pool->tcache_depth > 0 && pool->block_align < TCACHE_UNIT) {
+        return TCACHE_UNIT;
+    }
+    return pool->block_align;
+}
 
-    // Initialize the metadata array with a single large block
-    block_array = malloc(sizeof(Block));
-    if (!block_array) {
-        printf("Failed to allocate metadata array\n");
+// Calls are counted per thread, mem_stats sums them up
+static void count_calls(mem_pool_t* pool, int kind, uint64_t count) {
+    ThreadCache* cache = tcache_get(pool);
+    __atomic_store_n(&cache->calls[kind], cache->calls[kind] + count, __ATOMIC_RELAXED);
+}
+
+// Memory is handed out uninitialized, any zeroing is up to the caller and happens after
+// the arena lock has been released.
+static void* alloc_block(mem_pool_t* pool, size_t size, size_t alignment) {
+    if (alignment <= natural_alignment(pool)) {
+        alignment = 0;
+        if (pool->tcache_depth > 0 && size <= TCACHE_MAX_SIZE) {
+            return tcache_alloc(pool, size);
+        }
+    }
+
+    void* allocated_memory = arenas_alloc(pool, size, alignment);
+    if (allocated_memory == NULL && pool->tcache_depth > 0) {
+        ThreadCache* cache = pthread_getspecific(pool->tcache_key);
+        if (cache) {
+            tcache_release_all(cache); // Give the arenas a chance to coalesce our cached blocks
+            allocated_memory = arenas_alloc(pool, size, alignment);
+        }
+    }
+    return allocated_memory;
+}
+
+// Counted entry point of the allocation functions
+static void* alloc_uninit(mem_pool_t* pool, size_t size, size_t alignment) {
+    if (pool == NULL) {
+        return NULL; // No pool, e.g. mem_alloc before mem_init
+    }
+    void* allocated_memory = alloc_block(pool, size, alignment);
+    count_calls(pool, CALL_ALLOC, 1);
+    if (allocated_memory == NULL) {
+        count_calls(pool, CALL_FAILED_ALLOC, 1);
+    }
+    return allocated_memory;
+}
+
+void* mem_pool_alloc(mem_pool_t* pool, size_t size) {
+    void* allocated_memory = alloc_uninit(pool, size, 0);
+    if (allocated_memory && !pool->zero_in_lock) {
+        memset(allocated_memory, 0, size); // Initialize allocated memory to zero
+    }
+    return allocated_memory;
+}
+
+void* mem_pool_alloc_uninit(mem_pool_t* pool, size_t size) {
+    return alloc_uninit(pool, size, 0);
+}
+
+void* mem_pool_alloc_aligned(mem_pool_t* pool, size_t size, size_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        return NULL; // Not a power of two
+    }
+    void* allocated_memory = alloc_uninit(pool, size, alignment);
+    if (allocated_memory && !pool->zero_in_lock) {
+        memset(allocated_memory, 0, size); // Initialize allocated memory to zero
+    }
+    return allocated_memory;
+}
+
+void* mem_pool_calloc(mem_pool_t* pool, size_t count, size_t size) {
+    if (size != 0 && count > SIZE_MAX / size) {
+        return NULL; // count * size overflows
+    }
+    return mem_pool_alloc(pool, count * size);
+}
+
+static void free_block(mem_pool_t* pool, void* block) {
+    if (pool->tcache_depth > 0 && tcache_free(pool, block)) {
+        return;
+    }
+
+    Arena* arena = arena_of(pool, block);
+    if (arena == NULL) {
+        return; // Not a block of the pool
+    }
+    arena_lock(arena, MEM_LOCK_FREE); // Lock helps to prevent multiple threads from freeing memory
+    pool_free(arena, block);
+    arena_unlock(arena, MEM_LOCK_FREE); // Unlock before return
+}
+
+void mem_pool_free(mem_pool_t* pool, void* block) {
+    if (pool == NULL) {
+        return;
+    }
+    count_calls(pool, CALL_FREE, 1);
+    free_block(pool, block);
+}
+
+// Each arena's lock is taken once for as many blocks as it can hand out, starting with the
+// calling thread's arena. Whatever is left goes through the single-block path, which can also
+// grow the pool. Returns the number of blocks written to out.
+size_t mem_pool_alloc_bulk(mem_pool_t* pool, size_t size, size_t count, void** out) {
+    if (pool == NULL) {
+        return 0;
+    }
+    size_t n = 0;
+    size_t home = thread_arena(pool);
+    for (size_t i = 0; i < pool->arena_count && n < count; i++) {
+        Arena* arena = &pool->arenas[(home + i) % pool->arena_count];
+        arena_lock(arena, MEM_LOCK_ALLOC);
+        n += pool_alloc_run(arena, size, count - n, out + n);
+        arena_unlock(arena, MEM_LOCK_ALLOC);
+    }
+    while (n < count && (out[n] = alloc_block(pool, size, 0)) != NULL) {
+        n++;
+    }
+    count_calls(pool, CALL_ALLOC, n);
+    if (n < count) {
+        count_calls(pool, CALL_FAILED_ALLOC, 1);
+    }
+    for (size_t i = 0; i < n; i++) {
+        memset(out[i], 0, size);
+    }
+    return n;
+}
+
+static int compare_pointers(const void* a, const void* b) {
+    uintptr_t x = *(const uintptr_t*)a, y = *(const uintptr_t*)b;
+    return (x > y) - (x < y);
+}
+
+// Sorting the blocks by address groups them by arena, so each lock is taken once, and lets
+// the block-list engine merge adjacent blocks in one pass. The array is sorted in place, and
+// blocks already parked in a thread cache are set to NULL, as tcache_free would ignore them.
+void mem_pool_free_bulk(mem_pool_t* pool, void** blocks, size_t count) {
+    if (pool == NULL) {
+        return;
+    }
+    count_calls(pool, CALL_FREE, count);
+    for (size_t i = 0; i < count && pool->tcache_depth > 0; i++) {
+        if (tcache_units_of(pool, blocks[i]) == TCACHE_PARKED) {
+            blocks[i] = NULL; // Freed again while cached, the cache keeps it
+        }
+    }
+    qsort(blocks, count, sizeof(void*), compare_pointers);
+    size_t i = 0;
+    while (i < count) {
+        Arena* arena = arena_of(pool, blocks[i]);
+        if (arena == NULL) {
+            i++; // NULL or not a block of the pool
+            continue;
+        }
+        arena_lock(arena, MEM_LOCK_FREE);
+        while (i < count && arena_of(pool, blocks[i]) == arena) {
+            i += pool_free_run(arena, blocks + i, count - i);
+        }
+        if (pool->growable) {
+            arena_trim(arena);
+        }
+        arena_unlock(arena, MEM_LOCK_FREE);
+    }
+}
+
+// Shrinking, growing in place and moving within the arena all happen in one critical section.
+// Only when the arena is full is the block copied to another arena, whose lock is taken on its own.
+void* mem_pool_resize(mem_pool_t* pool, void* block, size_t size) {
+    if (pool == NULL) {
+        return NULL;
+    }
+    count_calls(pool, CALL_RESIZE, 1);
+    Arena* arena = arena_of(pool, block);
+    if (arena == NULL) {
+        return NULL; // Block not found
+    }
+
+    arena_lock(arena, MEM_LOCK_RESIZE); // Lock helps to prevent multiple threads from resizing memory
+    void* resized;
+    size_t old_size = 0; // Bytes to copy if the block has to leave the arena, 0 if it is not a block
+    switch (pool->engine) {
+    case MEM_ENGINE_BOUNDARY_TAG: {
+        TagBlock* tag = tag_lookup(arena, block);
+        resized = tag ? tag_resize(arena, tag, size) : NULL;
+        if (tag && !resized) {
+            old_size = tag_size(tag) - TAG_OVERHEAD;
+        }
+        break;
+    }
+    case MEM_ENGINE_BUMP:
+        resized = bump_resize(arena, block, size, &old_size);
+        break;
+    case MEM_ENGINE_BUDDY:
+        resized = buddy_resize(arena, block, size, &old_size);
+        break;
+    default: {
+        Block* current = index_find(arena, block);
+        resized = current ? list_resize(arena, current, size) : NULL;
+        if (current && !resized) {
+            old_size = current->size;
+        }
+        break;
+    }
+    }
+    if (resized && pool->growable) {
+        arena_trim(arena);
+    }
+    arena_unlock(arena, MEM_LOCK_RESIZE); // Unlock before return
+    if (resized != NULL || old_size == 0) {
+        return resized;
+    }
+
+    // Allocate a new block in another arena, or grow the pool. Its contents are overwritten right away.
+    void* new_block_memory = alloc_block(pool, size, 0);
+    if (new_block_memory) {
+        memcpy(new_block_memory, block, old_size);
+        free_block(pool, block);
+        resize_count(pool, RESIZE_MOVED);
+    }
+    return new_block_memory;
+}
+
+mem_resize_stats_t mem_pool_resize_stats(mem_pool_t* pool) {
+    return (mem_resize_stats_t){
+        .in_place = __atomic_load_n(&pool->resize_counts[RESIZE_IN_PLACE], __ATOMIC_RELAXED),
+        .forward = __atomic_load_n(&pool->resize_counts[RESIZE_FORWARD], __ATOMIC_RELAXED),
+        .backward = __atomic_load_n(&pool->resize_counts[RESIZE_BACKWARD], __ATOMIC_RELAXED),
+        .relocated = __atomic_load_n(&pool->resize_counts[RESIZE_RELOCATED], __ATOMIC_RELAXED),
+        .moved = __atomic_load_n(&pool->resize_counts[RESIZE_MOVED], __ATOMIC_RELAXED),
+    };
+}
+
+void mem_pool_destroy(mem_pool_t* pool) {
+    if (pool == NULL) {
+        return;
+    }
+    // Caches of threads that are still alive die with the pool
+    while (pool->tcache_registry != NULL) {
+        ThreadCache* next = pool->tcache_registry->next;
+        free(pool->tcache_registry);
+        pool->tcache_registry = next;
+    }
+    pthread_key_delete(pool->tcache_key);
+    free(pool->class_map);
+
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        Arena* arena = &pool->arenas[i];
+        Block* current = arena->block_array;
+        while (current != NULL) {
+            Block* next = current->next;
+            free(current);
+            current = next;
+        }
+        free(arena->block_index);
+        free(arena->buddy_orders);
+        for (size_t order = 0; order < BUDDY_ORDERS; order++) {
+            free(arena->buddy_bits[order]);
+        }
+        pthread_mutex_destroy(&arena->mutex);
+    }
+    free(pool->arenas);
+
+    if (pool->growable) {
+        munmap(pool->memory, pool->size);
+    } else {
+        free(pool->memory);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+// Markers record the top of every arena. The record itself is bump allocated right after
+// the recorded tops, so resetting to a marker releases the marker too.
+typedef struct {
+    char* top;
+    size_t blocks; // Allocated blocks below top
+} BumpMark;
+
+struct mem_marker {
+    size_t count;
+    BumpMark arenas[]; // One per arena
+};
+
+static void bump_check(mem_pool_t* pool, const char* function) {
+    if (pool->engine != MEM_ENGINE_BUMP) {
+        printf("%s needs a pool with MEM_ENGINE_BUMP\n", function);
         exit(1);
     }
+}
+
+// Arena locks are always taken in index order, nothing else holds two of them at once
+static void arenas_lock_all(mem_pool_t* pool) {
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        arena_lock(&pool->arenas[i], MEM_LOCK_RESET);
+    }
+}
+
+static void arenas_unlock_all(mem_pool_t* pool) {
+    for (size_t i = pool->arena_count; i > 0; i--) {
+        arena_unlock(&pool->arenas[i - 1], MEM_LOCK_RESET);
+    }
+}
+
+// Moves the arena's top back down to top and returns trimmed memory to the system
+static void bump_reset(Arena* arena, char* top, size_t blocks) {
+    if (top < arena->bump_top) {
+        arena->bump_top = top;
+        arena->bump_last = NULL;
+        arena->block_count = blocks;
+    }
+    if (arena->pool->growable) {
+        arena_trim(arena);
+    }
+}
+
+void mem_pool_reset(mem_pool_t* pool) {
+    bump_check(pool, "mem_reset");
+    arenas_lock_all(pool);
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        bump_reset(&pool->arenas[i], pool->arenas[i].base, 0);
+    }
+    arenas_unlock_all(pool);
+}
+
+mem_marker_t* mem_pool_mark(mem_pool_t* pool) {
+    bump_check(pool, "mem_mark");
+    size_t size = sizeof(mem_marker_t) + pool->arena_count * sizeof(BumpMark);
+    arenas_lock_all(pool);
+    BumpMark tops[pool->arena_count];
+    for (size_t i = 0; i < pool->arena_count; i++) {
+        tops[i] = (BumpMark){pool->arenas[i].bump_top, pool->arenas[i].block_count};
+    }
+    Arena* arena = &pool->arenas[0];
+    mem_marker_t* marker = bump_alloc(arena, size, sizeof(char*));
+    if (marker == NULL && pool->growable && arena_grow(arena, size + sizeof(char*))) {
+        marker = bump_alloc(arena, size, sizeof(char*));
+    }
+    if (marker != NULL) {
+        marker->count = pool->arena_count;
+        memcpy(marker->arenas, tops, sizeof(tops));
+        arena->bump_last = NULL; // The marker can't be freed like a block
+        arena->block_count--;    // Nor is it counted as one
+    }
+    arenas_unlock_all(pool);
+    return marker;
+}
+
+void mem_pool_reset_to(mem_pool_t* pool, mem_marker_t* marker) {
+    bump_check(pool, "mem_reset_to");
+    if (marker == NULL) {
+        return; // mem_mark failed, there is nothing to go back to
+    }
+    arenas_lock_all(pool);
+    // Copied first, trimming arena 0 may unmap the marker
+    size_t count = marker->count;
+    BumpMark tops[count];
+    memcpy(tops, marker->arenas, sizeof(tops));
+    for (size_t i = 0; i < count; i++) {
+        bump_reset(&pool->arenas[i], tops[i].top, tops[i].blocks);
+    }
+    arenas_unlock_all(pool);
+}
+
+// The process-wide API of earlier versions, backed by the default pool
+
+void mem_init(size_t size) {
+    mem_init_config(size, (mem_config_t){.engine = MEM_DEFAULT_ENGINE});
+}
 
-    block_array->size = size;
-    block_array->free = true;
-    block_array->memory = memory_pool;
-    block_array->next = NULL;
+void mem_init_config(size_t size, mem_config_t config) {
+    pthread_mutex_lock(&memory_mutex); // Lock helps to prevent multiple threads from initializing memory pool
+    default_pool = mem_pool_create_config(size, config);
     pthread_mutex_unlock(&memory_mutex); // Unlock after initialization
 }
 
 void* mem_alloc(size_t size) {
-    pthread_mutex_lock(&memory_mutex); // Lock helps to prevent multiple threads from allocating memory
-    Block* current = block_array;
-    while (current != NULL) {
-        if (current->free && current->size >= size) {
-            // Split the block if it's larger than needed
-            if (current->size > size) {
-                Block* new_block = malloc(sizeof(Block));
-                if (!new_block) {
-                    printf("Failed to allocate new block metadata\n");
-                    pthread_mutex_unlock(&memory_mutex); // Unlock before exit
-                    exit(1);
-                }
-                new_block->size = current->size - size;
-                new_block->free = true;
-                new_block->memory = (void*)((uintptr_t)current->memory + size);
-                new_block->next = current->next;
-
-                current->size = size;
-                current->next = new_block;
-            }
-            current->free = false;
-            void* allocated_memory = current->memory;
-            memset(allocated_memory, 0, size); // Initialize allocated memory to zero
-            pthread_mutex_unlock(&memory_mutex); // Unlock before return
-            return allocated_memory;
+    return mem_pool_alloc(default_pool, size);
+}
+
+void* mem_alloc_uninit(size_t size) {
+    return mem_pool_alloc_uninit(default_pool, size);
+}
+
+void* mem_alloc_aligned(size_t size, size_t alignment) {
+    return mem_pool_alloc_aligned(default_pool, size, alignment);
+}
+
+void* mem_calloc(size_t count, size_t size) {
+    return mem_pool_calloc(default_pool, count, size);
+}
+
+void mem_free(void* block) {
+    mem_pool_free(default_pool, block);
+}
+
+size_t mem_alloc_bulk(size_t size, size_t count, void** out) {
+    return mem_pool_alloc_bulk(default_pool, size, count, out);
+}
+
+void mem_free_bulk(void** blocks, size_t count) {
+    mem_pool_free_bulk(default_pool, blocks, count);
+}
+
+void* mem_resize(void* block, size_t size) {
+    return mem_pool_resize(default_pool, block, size);
+}
+
+mem_tcache_stats_t mem_tcache_stats(void) {
+    if (default_pool == NULL) {
+        return (mem_tcache_stats_t){0};
+    }
+    return mem_pool_tcache_stats(default_pool);
+}
+
+mem_stats_t mem_stats(void) {
+    if (default_pool == NULL) {
+        return (mem_stats_t){0};
+    }
+    return mem_pool_stats(default_pool);
+}
+
+mem_fragmentation_t mem_fragmentation(void) {
+    if (default_pool == NULL) {
+        return (mem_fragmentation_t){0};
+    }
+    return mem_pool_fragmentation(default_pool);
+}
+
+void mem_dump(FILE* out) {
+    if (default_pool != NULL) {
+        mem_pool_dump(default_pool, out);
+    }
+}
+
+mem_resize_stats_t mem_resize_stats(void) {
+    if (default_pool == NULL) {
+        return (mem_resize_stats_t){0};
+    }
+    return mem_pool_resize_stats(default_pool);
+}
+
+size_t mem_resident_size(void) {
+    return default_pool ? mem_pool_resident_size(default_pool) : 0;
+}
+
+void mem_reset(void) {
+    mem_pool_reset(default_pool);
+}
+
+mem_marker_t* mem_mark(void) {
+    return mem_pool_mark(default_pool);
+}
+
+void mem_reset_to(mem_marker_t* marker) {
+    mem_pool_reset_to(default_pool, marker);
+}
+
+void mem_deinit() {
+    pthread_mutex_lock(&memory_mutex); // Lock helps to prevent multiple threads from deinitializing memory pool
+    mem_pool_destroy(default_pool);
+    default_pool = NULL;
+    pthread_mutex_unlock(&memory_mutex); // Unlock after deinitialization
+}
+
+// Slabs: count objects of one size carved out of a single pool block. Free objects form a
+// Treiber stack of indices, the head word packs a modification tag (high 32 bits) with the
+// index + 1 of the top object (low 32 bits, 0 when empty), so a pop whose top was popped and
+// pushed back in between fails its CAS instead of installing a stale next index (ABA).
+struct mem_slab {
+    uint64_t head;
+    mem_pool_t* pool; // Pool the slab's memory comes from
+    uint32_t* next; // Index + 1 of the object below each free object, kept outside the objects
+    void* memory;
+    size_t obj_size;
+    size_t count;
+};
+
+#define SLAB_INDEX(word) ((uint32_t)(word))
+#define SLAB_WORD(tag, index) (((uint64_t)(tag) << 32) | (uint32_t)(index))
+
+mem_slab_t* mem_pool_slab_create(mem_pool_t* pool, size_t obj_size, size_t count) {
+    if (pool == NULL || obj_size == 0 || count == 0 || count >= UINT32_MAX) {
+        return NULL;
+    }
+    size_t align = pool->block_align > sizeof(void*) ? pool->block_align : sizeof(void*);
+    obj_size = (obj_size + align - 1) & ~(align - 1); // Objects keep the pool's block alignment
+    mem_slab_t* slab = malloc(sizeof(mem_slab_t));
+    if (!slab) {
+        printf("Failed to allocate slab\n");
+        exit(1);
+    }
+    slab->next = malloc(count * sizeof(uint32_t));
+    if (!slab->next) {
+        printf("Failed to allocate slab free list\n");
+        exit(1);
+    }
+    slab->memory = mem_pool_alloc(pool, obj_size * count);
+    if (slab->memory == NULL) {
+        free(slab->next);
+        free(slab);
+        return NULL; // The pool can't hold the slab
+    }
+    slab->pool = pool;
+    slab->obj_size = obj_size;
+    slab->count = count;
+
+    // Initially every object is free, object 0 on top
+    for (size_t i = 0; i < count; i++) {
+        slab->next[i] = i + 1 < count ? i + 2 : 0;
+    }
+    slab->head = SLAB_WORD(0, 1);
+    return slab;
+}
+
+mem_slab_t* mem_slab_create(size_t obj_size, size_t count) {
+    return mem_pool_slab_create(default_pool, obj_size, count);
+}
+
+void* mem_slab_alloc(mem_slab_t* slab) {
+    uint64_t head = __atomic_load_n(&slab->head, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t index = SLAB_INDEX(head);
+        if (index == 0) {
+            return NULL; // Slab exhausted
+        }
+        // May read the link of an object another thread just popped, the CAS then fails on the tag
+        uint32_t next = __atomic_load_n(&slab->next[index - 1], __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&slab->head, &head, SLAB_WORD((head >> 32) + 1, next),
+                                        true, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+            return (void*)((uintptr_t)slab->memory + (index - 1) * slab->obj_size);
         }
-        current = current->next;
     }
-    pthread_mutex_unlock(&memory_mutex); // Unlock before return
-    return NULL; // No suitable block found
 }
 
-void mem_free(void* block) {
-    pthread_mutex_lock(&memory_mutex); // Lock helps to prevent multiple threads from freeing memory
-    Block* current = block_array;
-    Block* prev = NULL;
-    while (current != NULL) {
-        if (current->memory == block) {
-            current->free = true;
-
-            // Coalesce with next free blocks
-            while (current->next != NULL && current->next->free) {
-                Block* temp = current->next;
-                current->size += temp->size;
-                current->next = temp->next;
-                free(temp);
-            }
+void mem_slab_free(mem_slab_t* slab, void* object) {
+    uintptr_t offset = (uintptr_t)object - (uintptr_t)slab->memory;
+    if (object == NULL || offset >= slab->obj_size * slab->count || offset % slab->obj_size != 0) {
+        return; // Not an object of this slab
+    }
+    uint32_t index = offset / slab->obj_size + 1;
+    uint64_t head = __atomic_load_n(&slab->head, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&slab->next[index - 1], SLAB_INDEX(head), __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&slab->head, &head, SLAB_WORD((head >> 32) + 1, index),
+                                          true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
 
-            // Coalesce with previous free blocks
-            if (prev != NULL && prev->free) {
-                prev->size += current->size;
-                prev->next = current->next;
-                free(current);
-            }
+void mem_slab_destroy(mem_slab_t* slab) {
+    if (slab == NULL) {
+        return;
+    }
+    mem_pool_free(slab->pool, slab->memory);
+    free(slab->next);
+    free(slab);
+}
 
-            pthread_mutex_unlock(&memory_mutex); // Unlock before return
-            return;
+// Epoch-based reclamation. A retired object goes into the calling thread's bag for the current
+// global epoch. The epoch only advances once every thread inside a critical section has seen it,
+// so two advances after an object was retired no reader can still hold it, and its bag is
+// released in one call. Bags are reused round-robin, the one for epoch e also served e - 3.
+#define EBR_BAGS 3
+#define EBR_BATCH 64 // Retired objects in a bag before the calling thread tries to advance the epoch
+
+typedef struct {
+    void** objects;
+    size_t count;
+    size_t capacity;
+    uint64_t epoch;
+} EbrBag;
+
+// One per thread and reclaimer. Records are only freed with the reclaimer, a thread that exits
+// leaves its record with whatever it retired to the next thread that takes it.
+typedef struct EbrRecord {
+    uint64_t epoch;  // Global epoch seen on entering the critical section
+    int active;      // Inside a critical section
+    int depth;       // Nesting of mem_ebr_enter, only the outermost one publishes the epoch
+    int owned;       // Taken by a live thread
+    struct EbrRecord* next;
+    EbrBag bags[EBR_BAGS];
+} __attribute__((aligned(MEM_CACHE_LINE))) EbrRecord;
+
+struct mem_ebr {
+    uint64_t epoch __attribute__((aligned(MEM_CACHE_LINE)));
+    EbrRecord* records __attribute__((aligned(MEM_CACHE_LINE)));
+    pthread_key_t key;
+    mem_release_fn release;
+    void* context;
+};
+
+static void ebr_record_release(void* arg) {
+    EbrRecord* record = arg;
+    record->depth = 0;
+    __atomic_store_n(&record->active, 0, __ATOMIC_RELEASE);
+    __atomic_store_n(&record->owned, 0, __ATOMIC_RELEASE);
+}
+
+mem_ebr_t* mem_ebr_create(mem_release_fn release, void* context) {
+    mem_ebr_t* ebr = calloc(1, sizeof(mem_ebr_t));
+    if (!ebr) {
+        printf("Failed to allocate reclaimer\n");
+        return NULL;
+    }
+    if (pthread_key_create(&ebr->key, ebr_record_release) != 0) {
+        free(ebr);
+        return NULL;
+    }
+    ebr->release = release;
+    ebr->context = context;
+    return ebr;
+}
+
+static void release_to_pool(void** objects, size_t count, void* context) {
+    mem_pool_free_bulk(context, objects, count);
+}
+
+mem_ebr_t* mem_pool_ebr_create(mem_pool_t* pool) {
+    return pool ? mem_ebr_create(release_to_pool, pool) : NULL;
+}
+
+static void release_to_slab(void** objects, size_t count, void* context) {
+    for (size_t i = 0; i < count; i++) {
+        mem_slab_free(context, objects[i]);
+    }
+}
+
+mem_ebr_t* mem_slab_ebr_create(mem_slab_t* slab) {
+    return slab ? mem_ebr_create(release_to_slab, slab) : NULL;
+}
+
+static void ebr_bag_release(mem_ebr_t* ebr, EbrBag* bag) {
+    if (bag->count > 0) {
+        ebr->release(bag->objects, bag->count, ebr->context);
+        bag->count = 0;
+    }
+}
+
+void mem_ebr_destroy(mem_ebr_t* ebr) {
+    if (ebr == NULL) {
+        return;
+    }
+    pthread_key_delete(ebr->key);
+    EbrRecord* record = ebr->records;
+    while (record != NULL) {
+        EbrRecord* next = record->next;
+        for (int i = 0; i < EBR_BAGS; i++) {
+            ebr_bag_release(ebr, &record->bags[i]);
+            free(record->bags[i].objects);
         }
-        prev = current;
-        current = current->next;
+        free(record);
+        record = next;
     }
-    pthread_mutex_unlock(&memory_mutex); // Unlock before return
+    free(ebr);
 }
 
-void* mem_resize(void* block, size_t size) {
-    pthread_mutex_lock(&memory_mutex); // Lock helps to prevent multiple threads from resizing memory
-    Block* current = block_array;
-    while (current != NULL) {
-        if (current->memory == block) {
-            if (current->size == size) {
-                pthread_mutex_unlock(&memory_mutex); // Unlock before return
-                return block;
-            } else if (current->size > size) {
-                // Shrink the block
-                Block* new_block = malloc(sizeof(Block));
-                if (!new_block) {
-                    printf("Failed to allocate new block metadata\n");
-                    pthread_mutex_unlock(&memory_mutex); // Unlock before exit
-                    exit(1);
-                }
-                new_block->size = current->size - size;
-                new_block->free = true;
-                new_block->memory = (void*)((uintptr_t)current->memory + size);
-                new_block->next = current->next;
-
-                current->size = size;
-                current->next = new_block;
-
-                pthread_mutex_unlock(&memory_mutex); // Unlock before return
-                return current->memory;
-            } else {
-                // Check if next block is free and adjacent
-                if (current->next != NULL && current->next->free &&
-                    (uintptr_t)current->memory + current->size == (uintptr_t)current->next->memory &&
-                    current->size + current->next->size >= size) {
-                    // Merge with next block
-                    Block* next_block = current->next;
-                    current->size += next_block->size;
-                    current->next = next_block->next;
-                    free(next_block);
-
-                    // Attempt to resize again
-                    if (current->size >= size) {
-                        // Split if larger than needed
-                        if (current->size > size) {
-                            Block* new_block = malloc(sizeof(Block));
-                            if (!new_block) {
-                                printf("Failed to allocate new block metadata\n");
-                                pthread_mutex_unlock(&memory_mutex); // Unlock before exit
-                                exit(1);
-                            }
-                            new_block->size = current->size - size;
-                            new_block->free = true;
-                            new_block->memory = (void*)((uintptr_t)current->memory + size);
-                            new_block->next = current->next;
-
-                            current->size = size;
-                            current->next = new_block;
-                        }
-                        pthread_mutex_unlock(&memory_mutex); // Unlock before return
-                        return current->memory;
-                    }
-                }
-                pthread_mutex_unlock(&memory_mutex); // Unlock before return
-                // Allocate a new block
-                void* new_block_memory = mem_alloc(size);
-                if (new_block_memory) {
-                    memcpy(new_block_memory, block, current->size);
-                    mem_free(block);
-                }
-                return new_block_memory;
-            }
+static EbrRecord* ebr_record(mem_ebr_t* ebr) {
+    EbrRecord* record = pthread_getspecific(ebr->key);
+    if (record != NULL) {
+        return record;
+    }
+    for (record = __atomic_load_n(&ebr->records, __ATOMIC_ACQUIRE); record != NULL; record = record->next) {
+        int free_record = 0;
+        if (__atomic_load_n(&record->owned, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&record->owned, &free_record, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+    if (record == NULL) {
+        if (posix_memalign((void**)&record, MEM_CACHE_LINE, sizeof(EbrRecord)) != 0) {
+            printf("Failed to allocate reclaimer record\n");
+            exit(1);
+        }
+        memset(record, 0, sizeof(EbrRecord));
+        record->owned = 1;
+        record->next = __atomic_load_n(&ebr->records, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&ebr->records, &record->next, record, true, __ATOMIC_RELEASE,
+                                            __ATOMIC_RELAXED)) {
         }
-        current = current->next;
     }
-    pthread_mutex_unlock(&memory_mutex); // Unlock before return
-    return NULL; // Block not found
+    pthread_setspecific(ebr->key, record);
+    return record;
 }
 
-void mem_deinit() {
-    pthread_mutex_lock(&memory_mutex); // Lock helps to prevent multiple threads from deinitializing memory pool
-    free(memory_pool);
-    memory_pool = NULL;
-    memory_pool_size = 0;
+void mem_ebr_enter(mem_ebr_t* ebr) {
+    if (ebr == NULL) {
+        return;
+    }
+    EbrRecord* record = ebr_record(ebr);
+    if (record->depth++ > 0) {
+        return; // Nested, the outer section already protects everything read in this one
+    }
+    __atomic_store_n(&record->epoch, __atomic_load_n(&ebr->epoch, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    __atomic_store_n(&record->active, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST); // Published before the first read of shared objects
+}
 
-    Block* current = block_array;
-    while (current != NULL) {
-        Block* next = current->next;
-        free(current);
-        current = next;
+void mem_ebr_exit(mem_ebr_t* ebr) {
+    if (ebr == NULL) {
+        return;
     }
-    block_array = NULL;
+    EbrRecord* record = ebr_record(ebr);
+    if (record->depth > 0 && --record->depth == 0) {
+        __atomic_store_n(&record->active, 0, __ATOMIC_RELEASE);
+    }
+}
 
-    pthread_mutex_unlock(&memory_mutex); // Unlock after deinitialization
+// Moves the global epoch on if no thread is still inside a critical section of an older one
+static uint64_t ebr_advance(mem_ebr_t* ebr) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint64_t epoch = __atomic_load_n(&ebr->epoch, __ATOMIC_ACQUIRE);
+    for (EbrRecord* record = __atomic_load_n(&ebr->records, __ATOMIC_ACQUIRE); record != NULL; record = record->next) {
+        if (__atomic_load_n(&record->active, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&record->epoch, __ATOMIC_ACQUIRE) != epoch) {
+            return epoch;
+        }
+    }
+    if (__atomic_compare_exchange_n(&ebr->epoch, &epoch, epoch + 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return epoch + 1;
+    }
+    return epoch; // Another thread advanced it
 }
 
-void print_blocks_ADMIN() {
-    pthread_mutex_lock(&memory_mutex);
-    Block* current = block_array;
-    while (current != NULL) {
-        printf("Block at %p: size = %zu, free = %s, Memory at = %p\n",
-               (void*)current, current->size, current->free ? "true" : "false",
-               current->memory);
-        current = current->next;
+// Releases the calling thread's bags that are two or more epochs old
+static void ebr_collect(mem_ebr_t* ebr, EbrRecord* record, uint64_t epoch) {
+    for (int i = 0; i < EBR_BAGS; i++) {
+        if (record->bags[i].epoch + 2 <= epoch) {
+            ebr_bag_release(ebr, &record->bags[i]);
+        }
+    }
+}
+
+void mem_ebr_retire(mem_ebr_t* ebr, void* object) {
+    if (ebr == NULL || object == NULL) {
+        return;
     }
-    pthread_mutex_unlock(&memory_mutex);
+    EbrRecord* record = ebr_record(ebr);
+    // Pairs with the fences in mem_ebr_enter and ebr_advance: the caller's unlink of object is
+    // ordered before the epoch is read, so a reader that still sees object entered no later
+    // than that epoch and object can't be released while it is inside. Callers therefore may
+    // retire outside a critical section, with relaxed unlinking stores.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    uint64_t epoch = __atomic_load_n(&ebr->epoch, __ATOMIC_RELAXED);
+    EbrBag* bag = &record->bags[epoch % EBR_BAGS];
+    if (bag->epoch != epoch) {
+        ebr_bag_release(ebr, bag); // Left over from epoch - 3 or earlier
+        bag->epoch = epoch;
+    }
+    if (bag->count == bag->capacity) {
+        size_t capacity = bag->capacity ? bag->capacity * 2 : EBR_BATCH;
+        void** objects = realloc(bag->objects, capacity * sizeof(void*));
+        if (!objects) {
+            printf("Failed to grow reclaimer bag\n");
+            exit(1);
+        }
+        bag->objects = objects;
+        bag->capacity = capacity;
+    }
+    bag->objects[bag->count++] = object;
+    if (bag->count >= EBR_BATCH) {
+        ebr_collect(ebr, record, ebr_advance(ebr));
+    }
+}
+
+void mem_ebr_flush(mem_ebr_t* ebr) {
+    if (ebr == NULL) {
+        return;
+    }
+    ebr_collect(ebr, ebr_record(ebr), ebr_advance(ebr));
+}
+
+// Pool summary instead of one line per block
+void print_blocks_ADMIN() {
+    mem_dump(stdout);
 }
 
 void print_blocks_USR() {
-    pthread_mutex_lock(&memory_mutex);
-    Block* current = block_array;
-    while (current != NULL) {
-        printf("Block at %p: size = %zu, free = %s\n",
-               current->memory, current->size, current->free ? "true" : "false");
-        current = current->next;
+    mem_pool_t* pool = default_pool;
+    for (size_t i = 0; pool != NULL && i < pool->arena_count; i++) {
+        Arena* arena = &pool->arenas[i];
+        pthread_mutex_lock(&arena->mutex);
+        if (pool->engine == MEM_ENGINE_BUMP) {
+            size_t used = arena->bump_top - (char*)arena->base;
+            printf("Block at %p: size = %zu, free = false\n", arena->base, used);
+            printf("Block at %p: size = %zu, free = true\n", (void*)arena->bump_top, arena->size - used);
+        } else if (pool->engine == MEM_ENGINE_BUDDY) {
+            bool is_free;
+            size_t size;
+            for (size_t offset = 0; (size = buddy_block_at(arena, offset, &is_free)) > 0; offset += size) {
+                printf("Block at %p: size = %zu, free = %s\n",
+                       (void*)((uintptr_t)arena->base + offset), size, is_free ? "true" : "false");
+            }
+        } else if (pool->engine == MEM_ENGINE_BOUNDARY_TAG) {
+            for (TagBlock* tag = arena->tag_first; tag < arena->tag_end; tag = tag_next(tag)) {
+                printf("Block at %p: size = %zu, free = %s\n",
+                       (void*)((uintptr_t)tag + TAG_OVERHEAD), tag_size(tag) - TAG_OVERHEAD,
+                       (tag->header & TAG_FREE) ? "true" : "false");
+            }
+        } else {
+            Block* current = arena->block_array;
+            while (current != NULL) {
+                printf("Block at %p: size = %zu, free = %s\n",
+                       current->memory, current->size, current->free ? "true" : "false");
+                current = current->next;
+            }
+        }
+        pthread_mutex_unlock(&arena->mutex);
     }
-    pthread_mutex_unlock(&memory_mutex);
 }
 
 int mainNN() {
@@ -253,7 +3213,8 @@ int mainNN() {
     scanf("%lu", &size);
     mem_init(size);
     printf("Memory pool is allocated\n");
-    printf("Memory pool address: %p\n", memory_pool);
+    printf("Memory pool address: %p\n", default_pool->memory);
+
     print_blocks_USR();
 
     while (true)
@@ -2,18 +2,201 @@
 #define MEMORY_MANAGER_H
 
 #include <stddef.h> // For size_t
+#include <stdio.h> // For FILE
 #include <stdint.h> // For uintptr_t
 #include <pthread.h> // For pthread_mutex_t
 #include <math.h> // For pow
 
+// Allocator engine used for a memory pool
+typedef enum {
+    MEM_ENGINE_BLOCK_LIST = 0, // Block metadata kept outside the pool (default)
+    MEM_ENGINE_BOUNDARY_TAG,   // Size/free headers and footers stored inside the pool
+    MEM_ENGINE_BUMP,           // Pointer-bump allocation, memory is released by mem_reset and markers
+    MEM_ENGINE_BUDDY,          // Binary buddy system, power-of-two blocks split and merged in O(log n)
+} mem_engine_t;
 
+// How threads are assigned to the arena they allocate from
+typedef enum {
+    MEM_ARENA_ROUND_ROBIN = 0, // Threads are spread over the arenas in order of their first allocation (default)
+    MEM_ARENA_CPU,             // The arena follows the CPU the thread is running on (sched_getcpu)
+} mem_arena_affinity_t;
 
+// How a free block is chosen for an allocation
+typedef enum {
+    MEM_FIT_SEGREGATED = 0, // Any block of the request's size-class bin that fits, else the next non-empty bin (default)
+    MEM_FIT_FIRST,          // Lowest-addressed block that fits
+    MEM_FIT_NEXT,           // First block that fits after the one the previous search stopped at
+    MEM_FIT_BEST,           // Smallest block that fits
+    MEM_FIT_ADDRESS_BEST,   // Smallest block that fits, the lowest-addressed among equals, found in a size tree
+} mem_placement_t;
+
+#define MEM_CACHE_LINE 64
+
+// Options for mem_init_config, zero-initialized fields select the defaults
+typedef struct {
+    mem_engine_t engine;
+    size_t tcache_depth; // Small blocks cached per size class and thread, 0 disables the thread caches
+    size_t arena_count;  // Independently locked slices of the pool, 0 selects a single arena
+    mem_arena_affinity_t arena_affinity;
+    size_t alignment;    // Power of two every allocation is rounded to, e.g. 16 or MEM_CACHE_LINE, 0 for none
+    mem_placement_t placement;
+    size_t max_size;       // Larger than the initial size: the pool grows on demand up to this many bytes
+    size_t grow_chunk;     // Growable pools: minimum growth step, 0 selects 64 KiB
+    size_t high_watermark; // Growable pools: free bytes at an arena's end that trigger a trim, 0 selects 4 * grow_chunk
+    size_t low_watermark;  // Growable pools: free bytes an arena keeps at its end after a trim
+    int zero_in_lock;      // Zero blocks before the arena lock is released, as before mem_alloc_uninit. For benchmarks,
+                           // disables the thread caches
+} mem_config_t;
+
+// Thread cache counters, summed over all threads of the pool
+typedef struct {
+    uint64_t hits;    // Small allocations served from the calling thread's cache
+    uint64_t misses;  // Small allocations that had to refill from an arena
+    uint64_t refills; // Batches taken from an arena
+    uint64_t flushes; // Batches returned to the arenas by full caches
+} mem_tcache_stats_t;
+
+// Pool state read from counters that every operation keeps up to date, cheap enough to poll
+typedef struct {
+    size_t in_use;         // Bytes of allocated blocks and engine overhead, blocks held by thread caches included
+    size_t peak_in_use;    // Sum of the arenas' highest in_use, the pool's own peak with a single arena
+    size_t free;           // Bytes left for allocations without growing the pool
+    size_t largest_free;   // Largest free block
+    size_t blocks;         // Allocated blocks
+    uint64_t allocs;       // Allocation calls, every block of a bulk call counts
+    uint64_t frees;
+    uint64_t resizes;
+    uint64_t failed_allocs;
+    uint64_t lock_waits;   // Arena lock acquisitions that found the lock taken
+    uint64_t lock_wait_ns; // Time spent waiting for arena locks
+} mem_stats_t;
+
+#define MEM_FREE_BUCKETS 64
+
+// Free space of a pool, read from per-size-class counts the engines keep up to date
+typedef struct {
+    size_t free;         // Bytes left for allocations without growing the pool
+    size_t largest_free; // Largest free block
+    size_t free_blocks;
+    double index;        // External fragmentation, 1 - largest_free / free: 0 when the free space is one block
+    size_t histogram[MEM_FREE_BUCKETS]; // histogram[k]: free blocks of 2^k to 2^(k + 1) - 1 bytes
+} mem_fragmentation_t;
+
+// How often each mem_resize path was taken
+typedef struct {
+    uint64_t in_place;  // Shrunk or kept its size
+    uint64_t forward;   // Grew into the free space after the block
+    uint64_t backward;  // Grew into a free predecessor, the contents were moved with memmove
+    uint64_t relocated; // Copied to another block of the same arena without dropping its lock
+    uint64_t moved;     // Copied to another arena or grown pool because the block's arena was full
+} mem_resize_stats_t;
+
+// Lock sites profiled by mem_lock_profile. The memory manager reports the arena locks taken
+// by each kind of call, linked_list.c the lock of each list.
+typedef enum {
+    MEM_LOCK_ALLOC = 0,   // Allocations, bulk allocations and thread cache refills
+    MEM_LOCK_FREE,        // Frees, bulk frees and thread cache flushes
+    MEM_LOCK_RESIZE,
+    MEM_LOCK_RESET,       // Bump pool resets and markers, which take every arena lock
+    MEM_LOCK_LIST_INSERT, // list_insert, list_insert_bulk and list_insert_before
+    MEM_LOCK_LIST_DELETE,
+    MEM_LOCK_LIST_READ,   // list_search, list_display and list_count_nodes
+    MEM_LOCK_SITES
+} mem_lock_site_t;
+
+// Lock counters of one site, summed over all threads and all locks taken there
+typedef struct {
+    uint64_t acquisitions;
+    uint64_t contended;   // Acquisitions that found the lock taken
+    uint64_t wait_ns;     // Time spent waiting in contended acquisitions
+    uint64_t max_wait_ns;
+    uint64_t hold_ns;     // Time from acquisition to release, nested acquisitions at the same site count once
+    uint64_t max_hold_ns;
+} mem_lock_stats_t;
+
+// Fixed-size object pool carved out of the memory pool, allocation and free are lock-free
+typedef struct mem_slab mem_slab_t;
+
+// Epoch-based reclaimer: objects retired while other threads may still be reading them are
+// released in batches once every thread has left the critical sections it was in
+typedef struct mem_ebr mem_ebr_t;
+typedef void (*mem_release_fn)(void** objects, size_t count, void* context);
+
+// Independent memory pool with its own memory, arenas, locks and thread caches
+typedef struct mem_pool mem_pool_t;
+
+// Savepoint of a MEM_ENGINE_BUMP pool, see mem_mark
+typedef struct mem_marker mem_marker_t;
+
+// Default pool, set up by mem_init
 void mem_init(size_t size);
-void* mem_alloc(size_t size);
+void mem_init_config(size_t size, mem_config_t config);
+void* mem_alloc(size_t size);                          // Zeroed memory
+void* mem_alloc_uninit(size_t size);                   // Memory with unspecified contents
+void* mem_calloc(size_t count, size_t size);           // Zeroed memory for count objects, NULL if the size overflows
+void* mem_alloc_aligned(size_t size, size_t alignment); // Zeroed memory at a multiple of alignment (a power of two)
 void mem_free(void* block);
+size_t mem_alloc_bulk(size_t size, size_t count, void** out); // Zeroed blocks, returns how many were allocated
+void mem_free_bulk(void** blocks, size_t count);              // Sorts blocks by address, NULL entries are skipped
 void* mem_resize(void* block, size_t size);
 void mem_deinit(void);
-void print_blocks_ADMIN(void);
+mem_stats_t mem_stats(void);
+mem_fragmentation_t mem_fragmentation(void);
+void mem_dump(FILE* out);
+mem_tcache_stats_t mem_tcache_stats(void);
+mem_resize_stats_t mem_resize_stats(void);
+size_t mem_resident_size(void); // Bytes of the pool currently backed by memory
+void mem_reset(void);                     // Bump pools: releases every allocation at once
+mem_marker_t* mem_mark(void);             // Bump pools: savepoint, NULL if the pool can't hold it
+void mem_reset_to(mem_marker_t* marker);  // Bump pools: releases everything allocated after marker, markers nest
+mem_slab_t* mem_slab_create(size_t obj_size, size_t count); // NULL if the pool can't hold count objects
+void* mem_slab_alloc(mem_slab_t* slab);                     // NULL when all objects are in use, memory is not zeroed
+void mem_slab_free(mem_slab_t* slab, void* object);
+void mem_slab_destroy(mem_slab_t* slab);                    // Returns the slab's memory to the pool
+
+mem_ebr_t* mem_ebr_create(mem_release_fn release, void* context); // release gets batches of retired objects
+mem_ebr_t* mem_pool_ebr_create(mem_pool_t* pool);                  // Retired blocks go back with mem_pool_free_bulk
+mem_ebr_t* mem_slab_ebr_create(mem_slab_t* slab);                  // Retired objects go back with mem_slab_free
+void mem_ebr_destroy(mem_ebr_t* ebr);           // Releases everything still retired, no thread may be inside
+void mem_ebr_enter(mem_ebr_t* ebr);             // Start of a critical section, objects read in it stay valid.
+void mem_ebr_exit(mem_ebr_t* ebr);              // Sections nest, both ignore a NULL reclaimer
+void mem_ebr_retire(mem_ebr_t* ebr, void* object); // Released once no critical section can still see it. Call after
+                                                   // object is unlinked, inside or outside a critical section
+void mem_ebr_flush(mem_ebr_t* ebr);             // Tries to advance the epoch and release the caller's old objects
+
+// Lock profiling, off by default. Enabling it clears the counters, while it is off the
+// wrappers cost one load of a flag on top of the plain pthread calls.
+void mem_lock_profile(int enable);
+void mem_lock_acquire(pthread_mutex_t* mutex, mem_lock_site_t site);
+void mem_lock_release(pthread_mutex_t* mutex, mem_lock_site_t site);
+mem_lock_stats_t mem_lock_stats(mem_lock_site_t site);
+void mem_lock_dump(FILE* out);          // Every site as one line of JSON
+void mem_lock_dump_at_exit(int signal); // Dumps to stderr at exit, and whenever signal arrives unless it is 0
+
+// Handle-based API, each pool is isolated from the others and from the default pool
+mem_pool_t* mem_pool_create(size_t size);
+mem_pool_t* mem_pool_create_config(size_t size, mem_config_t config);
+void mem_pool_destroy(mem_pool_t* pool); // Frees the pool with every block still allocated from it
+void* mem_pool_alloc(mem_pool_t* pool, size_t size);
+void* mem_pool_alloc_uninit(mem_pool_t* pool, size_t size);
+void* mem_pool_calloc(mem_pool_t* pool, size_t count, size_t size);
+void* mem_pool_alloc_aligned(mem_pool_t* pool, size_t size, size_t alignment);
+void mem_pool_free(mem_pool_t* pool, void* block); // Blocks of other pools are ignored
+size_t mem_pool_alloc_bulk(mem_pool_t* pool, size_t size, size_t count, void** out);
+void mem_pool_free_bulk(mem_pool_t* pool, void** blocks, size_t count);
+void* mem_pool_resize(mem_pool_t* pool, void* block, size_t size);
+mem_stats_t mem_pool_stats(mem_pool_t* pool);
+mem_fragmentation_t mem_pool_fragmentation(mem_pool_t* pool);
+void mem_pool_dump(mem_pool_t* pool, FILE* out); // Stats and fragmentation as one line of JSON
+mem_tcache_stats_t mem_pool_tcache_stats(mem_pool_t* pool);
+mem_resize_stats_t mem_pool_resize_stats(mem_pool_t* pool);
+size_t mem_pool_resident_size(mem_pool_t* pool);
+mem_slab_t* mem_pool_slab_create(mem_pool_t* pool, size_t obj_size, size_t count);
+void mem_pool_reset(mem_pool_t* pool);
+mem_marker_t* mem_pool_mark(mem_pool_t* pool);
+void mem_pool_reset_to(mem_pool_t* pool, mem_marker_t* marker);
+
+void print_blocks_ADMIN(void); // mem_dump to stdout
 void print_blocks_USR(void);
 uintptr_t calculate_distance(void* ptr1, void* ptr2);
 void* read_pointer(void);
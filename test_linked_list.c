@@ -1,10 +1,12 @@
 #include "linked_list.h"
+#include "unrolled_list.h"
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
 #include <time.h>
 #include <stddef.h>
 #include <math.h>
+#include <signal.h>
 #include "common_defs.h"
 #include "gitdata.h"
 
@@ -110,6 +112,61 @@ void test_list_insert_multithread(TestParams *params)
     free(thread_data);
 }
 
+void *thread_insert_bulk_function(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+    uint16_t *values = malloc(data->num_nodes * sizeof(uint16_t));
+    my_assert(values != NULL);
+    for (int i = 0; i < data->num_nodes; i++)
+    {
+        values[i] = data->start_value + i;
+    }
+    list_insert_bulk(data->head, values, data->num_nodes);
+    free(values);
+    return NULL;
+}
+
+void test_list_insert_bulk_multithread(TestParams *params)
+{
+    printf_yellow("  Testing list_insert_bulk (threads: %d, nodes: %d) ---> ", params->num_threads, params->num_nodes);
+
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * params->num_nodes);
+
+    pthread_t *threads = malloc(params->num_threads * sizeof(pthread_t));
+    thread_data_t *thread_data = malloc(params->num_threads * sizeof(thread_data_t));
+    int nodes_per_thread = params->num_nodes / params->num_threads;
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        thread_data[i].head = &head;
+        thread_data[i].start_value = i * nodes_per_thread;
+        thread_data[i].num_nodes = nodes_per_thread;
+        if (pthread_create(&threads[i], NULL, thread_insert_bulk_function, &thread_data[i]))
+        {
+            perror("Failed to create thread");
+        }
+    }
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Every batch is appended in one piece
+    my_assert(list_count_nodes(&head) == params->num_nodes);
+    for (Node *current = head; current != NULL; current = current->next)
+    {
+        if (current->data % nodes_per_thread != nodes_per_thread - 1)
+        {
+            my_assert(current->next != NULL && current->next->data == current->data + 1);
+        }
+    }
+    printf_green("[PASS].\n");
+    list_cleanup(&head);
+
+    free(threads);
+    free(thread_data);
+}
+
 void *thread_insert_after_function(void *arg)
 {
     thread_data_t *data = (thread_data_t *)arg;
@@ -542,6 +599,34 @@ void test_list_insert_loop(int count)
     printf_green("[PASS].\n");
 }
 
+void test_list_insert_bulk(int count)
+{
+    printf_yellow("  Testing list_insert_bulk ---> ");
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * (count + 1));
+    list_insert(&head, 0);
+
+    uint16_t *values = malloc(count * sizeof(uint16_t));
+    my_assert(values != NULL);
+    for (int i = 0; i < count; i++)
+    {
+        values[i] = i + 1;
+    }
+    list_insert_bulk(&head, values, count);
+    free(values);
+
+    my_assert(list_count_nodes(&head) == count + 1);
+    Node *current = head;
+    for (int i = 0; i <= count; i++)
+    {
+        my_assert(current->data == i);
+        current = current->next;
+    }
+
+    list_cleanup(&head);
+    printf_green("[PASS].\n");
+}
+
 void test_list_insert_after_loop(int count)
 {
     printf_yellow("  Testing list_insert_after loop ---> ");
@@ -644,6 +729,482 @@ void test_list_edge_cases()
     printf_green("[PASS].\n");
 }
 
+// Readers search and count while writers insert and delete values of their own: the values
+// that are never touched by a writer must always be found, and the count must stay in range.
+typedef struct
+{
+    Node **head;
+    int stable;      // Values 0 .. stable - 1 stay in the list
+    int churn;       // Values each writer inserts and deletes again
+    int thread_id;
+    int iterations;
+    int failures;
+} read_data_t;
+
+void *thread_churn_function(void *arg)
+{
+    read_data_t *data = (read_data_t *)arg;
+    uint16_t first = data->stable + data->thread_id * data->churn;
+    for (int n = 0; n < data->iterations; n++)
+    {
+        for (int i = 0; i < data->churn; i++)
+        {
+            list_insert(data->head, first + i);
+        }
+        for (int i = 0; i < data->churn; i++)
+        {
+            list_delete(data->head, first + i);
+        }
+    }
+    return NULL;
+}
+
+void *thread_reader_function(void *arg)
+{
+    read_data_t *data = (read_data_t *)arg;
+    for (int n = 0; n < data->iterations; n++)
+    {
+        uint16_t value = rand() % data->stable;
+        list_read_enter(data->head);
+        Node *found = list_search(data->head, value);
+        if (found == NULL || found->data != value)
+        {
+            data->failures++;
+        }
+        list_read_exit(data->head);
+        if (list_count_nodes(data->head) < data->stable)
+        {
+            data->failures++;
+        }
+    }
+    return NULL;
+}
+
+void test_list_read_multithread(TestParams *params)
+{
+    printf_yellow("  Testing list_search and list_count_nodes against writers (threads: %d, nodes: %d) ---> ", params->num_threads, params->num_nodes);
+    Node *head = NULL;
+    int stable = params->num_nodes / 2;
+    int churn = params->num_nodes / 2 / params->num_threads;
+    list_init(&head, sizeof(Node) * params->num_nodes);
+    for (int i = 0; i < stable; i++)
+    {
+        list_insert(&head, i);
+    }
+
+    pthread_t writers[params->num_threads], readers[params->num_threads];
+    read_data_t writer_data[params->num_threads], reader_data[params->num_threads];
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        writer_data[i] = (read_data_t){.head = &head, .stable = stable, .churn = churn, .thread_id = i, .iterations = 10};
+        reader_data[i] = (read_data_t){.head = &head, .stable = stable, .thread_id = i, .iterations = 1000};
+        pthread_create(&writers[i], NULL, thread_churn_function, &writer_data[i]);
+        pthread_create(&readers[i], NULL, thread_reader_function, &reader_data[i]);
+    }
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        pthread_join(writers[i], NULL);
+        pthread_join(readers[i], NULL);
+        my_assert(reader_data[i].failures == 0);
+    }
+
+    my_assert(list_count_nodes(&head) == stable);
+    list_cleanup(&head);
+    printf_green("[PASS].\n");
+}
+
+// Two lists set up side by side: appends, deletes and cleanup of one must not touch the other
+void test_list_independent(int count)
+{
+    printf_yellow("  Testing two independent lists (nodes: %d) ---> ", count);
+    Node *first = NULL, *second = NULL;
+    list_init(&first, sizeof(Node) * count);
+    list_init(&second, sizeof(Node) * count);
+    for (int i = 0; i < count; i++)
+    {
+        list_insert(&first, i);
+        list_insert(&second, count + i);
+    }
+    list_delete(&first, count - 1); // The tail of first
+    list_insert(&first, count - 1);
+    list_insert_after(list_search(&second, count), 0);
+
+    my_assert(list_count_nodes(&first) == count);
+    my_assert(list_count_nodes(&second) == count + 1);
+    Node *current = first;
+    for (int i = 0; i < count; i++)
+    {
+        my_assert(current->data == i);
+        current = current->next;
+    }
+
+    list_cleanup(&first);
+    my_assert(list_count_nodes(&first) == 0);
+    my_assert(list_memory_stats(&first).in_use == 0 && list_memory_stats(&second).in_use > 0);
+    my_assert(list_search(&second, 2 * count - 1) != NULL);
+    list_insert(&second, 1);
+    my_assert(list_count_nodes(&second) == count + 2);
+    list_cleanup(&second);
+    printf_green("[PASS].\n");
+}
+
+// Wraps ulist_display for capture_stdout
+void display_ulist(Node **list, Node *start_node, Node *end_node)
+{
+    ulist_display((ulist_t *)list);
+}
+
+// Every node but the tail must hold at least half a node of values
+int ulist_nodes_half_full(ulist_t *list)
+{
+    for (UNode *node = list->head; node != NULL; node = node->next)
+    {
+        if (node != list->tail && node->count < ULIST_NODE_VALUES / 2)
+        {
+            return 0;
+        }
+    }
+    return list->nodes <= list->count / (ULIST_NODE_VALUES / 2) + 1;
+}
+
+void test_ulist_operations(int count)
+{
+    printf_yellow("  Testing unrolled list operations (values: %d) ---> ", count);
+    ulist_t *list = ulist_create(2 * count);
+    for (int i = 0; i < count; i++)
+    {
+        ulist_insert(list, i);
+    }
+    my_assert(ulist_count(list) == (size_t)count);
+    my_assert(ulist_node_count(list) == (count + ULIST_NODE_VALUES - 1) / ULIST_NODE_VALUES); // Appends fill every node
+    for (int i = 0; i < count; i += 7)
+    {
+        my_assert(ulist_search(list, i) == i);
+    }
+    my_assert(ulist_search(list, count) == -1);
+
+    // Inserts into full nodes split them
+    size_t nodes = ulist_node_count(list);
+    my_assert(ulist_insert_after(list, 10, 60000));
+    my_assert(ulist_insert_before(list, 0, 60001));
+    my_assert(!ulist_insert_after(list, 60002, 1));
+    my_assert(ulist_search(list, 60001) == 0);
+    my_assert(ulist_search(list, 60000) == 12);
+    my_assert(ulist_search(list, 11) == 13);
+    my_assert(ulist_node_count(list) > nodes);
+    for (int i = 0; i < count; i += 2)
+    {
+        my_assert(ulist_insert_after(list, i, 50000 + i));
+    }
+    my_assert(ulist_count(list) == (size_t)(count + 2 + (count + 1) / 2));
+    my_assert(ulist_search(list, 50000) == 2);
+    my_assert(ulist_nodes_half_full(list));
+
+    // Deletes merge nodes or move values between them
+    my_assert(ulist_delete(list, 60000));
+    my_assert(ulist_delete(list, 60001));
+    my_assert(!ulist_delete(list, 60000));
+    for (int i = 0; i < count; i += 2)
+    {
+        my_assert(ulist_delete(list, 50000 + i));
+    }
+    for (int i = 0; i < count; i += 7)
+    {
+        my_assert(ulist_search(list, i) == i);
+    }
+    for (int i = 0; i < count; i += 3)
+    {
+        my_assert(ulist_delete(list, i));
+        my_assert(ulist_nodes_half_full(list));
+    }
+    my_assert(ulist_count(list) == (size_t)(count - (count + 2) / 3));
+    for (int i = 0; i < count; i++)
+    {
+        ulist_delete(list, i);
+    }
+    my_assert(ulist_count(list) == 0);
+    my_assert(ulist_node_count(list) == 0);
+    my_assert(list->head == NULL && list->tail == NULL);
+
+    char buffer[128] = {0}; // capture_stdout doesn't terminate short output
+    capture_stdout(buffer, sizeof(buffer), display_ulist, (Node **)list, NULL, NULL);
+    my_assert(strcmp(buffer, "[]\n") == 0);
+    ulist_insert(list, 1);
+    ulist_insert(list, 3);
+    ulist_insert_before(list, 3, 2);
+    memset(buffer, 0, sizeof(buffer));
+    capture_stdout(buffer, sizeof(buffer), display_ulist, (Node **)list, NULL, NULL);
+    my_assert(strcmp(buffer, "[1, 2, 3]\n") == 0);
+    ulist_destroy(list);
+    printf_green("[PASS].\n");
+}
+
+// Position of the first occurrence of data, read from the nodes one value at a time
+long ulist_reference_search(ulist_t *list, uint16_t data)
+{
+    long offset = 0;
+    for (UNode *node = list->head; node != NULL; node = node->next)
+    {
+        for (int i = 0; i < node->count; i++)
+        {
+            if (node->values[i] == data)
+            {
+                return offset + i;
+            }
+        }
+        offset += node->count;
+    }
+    return -1;
+}
+
+void test_ulist_search_kernels(int count)
+{
+    char *names[] = {"auto", "scalar", "SSE2", "AVX2"};
+    for (ulist_search_t kernel = ULIST_SEARCH_SCALAR; kernel <= ULIST_SEARCH_AVX2; kernel++)
+    {
+        ulist_search_t used = ulist_use_search(kernel);
+        printf_yellow("  Testing ulist_search with the %s kernel (in use: %s, values: %d) ---> ", names[kernel], names[used], count);
+        my_assert(used <= kernel);
+        ulist_t *list = ulist_create(2 * count);
+        // Duplicates, half-full nodes after splits and stale lanes behind deleted values
+        for (int i = 0; i < count; i++)
+        {
+            ulist_insert(list, i % (count / 2));
+        }
+        for (int i = 0; i < count / 2; i += 3)
+        {
+            ulist_insert_after(list, i, count + i);
+        }
+        for (int i = 0; i < count / 2; i += 5)
+        {
+            ulist_delete(list, i);
+        }
+        for (int value = 0; value < 2 * count; value++)
+        {
+            my_assert(ulist_search(list, value) == ulist_reference_search(list, value));
+        }
+        ulist_destroy(list);
+        printf_green("[PASS].\n");
+    }
+    ulist_use_search(ULIST_SEARCH_AUTO);
+}
+
+typedef struct
+{
+    ulist_t *list;
+    int thread_id;
+    int num_values;
+} ulist_data_t;
+
+// Appends its values, puts a marker behind every other one and deletes the markers again
+void *thread_ulist_function(void *arg)
+{
+    ulist_data_t *data = (ulist_data_t *)arg;
+    uint16_t first = data->thread_id * data->num_values;
+    for (int i = 0; i < data->num_values; i++)
+    {
+        ulist_insert(data->list, first + i);
+    }
+    for (int i = 0; i < data->num_values; i += 2)
+    {
+        ulist_insert_after(data->list, first + i, 60000 + data->thread_id);
+    }
+    for (int i = 0; i < data->num_values; i += 2)
+    {
+        ulist_delete(data->list, 60000 + data->thread_id);
+    }
+    return NULL;
+}
+
+void test_ulist_multithread(TestParams *params)
+{
+    printf_yellow("  Testing unrolled list with multiple threads (threads: %d, values: %d) ---> ", params->num_threads, params->num_nodes);
+    ulist_t *list = ulist_create(2 * params->num_nodes);
+    pthread_t threads[params->num_threads];
+    ulist_data_t data[params->num_threads];
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        data[i] = (ulist_data_t){.list = list, .thread_id = i, .num_values = params->num_nodes / params->num_threads};
+        pthread_create(&threads[i], NULL, thread_ulist_function, &data[i]);
+    }
+    for (int i = 0; i < params->num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    int total = params->num_threads * (params->num_nodes / params->num_threads);
+    my_assert(ulist_count(list) == (size_t)total);
+    for (int i = 0; i < total; i++)
+    {
+        my_assert(ulist_search(list, i) >= 0);
+    }
+    my_assert(ulist_search(list, 60000) == -1);
+    my_assert(ulist_nodes_half_full(list));
+    ulist_destroy(list);
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Benchmark: building a list of num_nodes values with list_insert, which appends behind the
+ * tail, against list_insert_walk, which locks its way from the head to the end for every value.
+ * The walk grows quadratically with the list length, the tail append should stay flat.
+ */
+typedef struct
+{
+    Node **head;
+    int num_nodes;
+    void (*insert)(Node **, uint16_t);
+} append_data_t;
+
+void *thread_append_function(void *arg)
+{
+    append_data_t *data = (append_data_t *)arg;
+    for (int i = 0; i < data->num_nodes; i++)
+    {
+        data->insert(data->head, i);
+    }
+    return NULL;
+}
+
+void benchmark_append(int num_nodes)
+{
+    void (*inserts[])(Node **, uint16_t) = {list_insert_walk, list_insert};
+    char *names[] = {"walk from head", "tail append"};
+    printf_yellow("  Benchmarking appending %d nodes:\n", num_nodes);
+
+    for (int i = 0; i < 9; i += 2) // 1 up to 256 threads
+    {
+        int num_threads = (int)pow(2, i);
+        for (int k = 0; k < 2; k++)
+        {
+            Node *head = NULL;
+            list_init(&head, sizeof(Node) * num_nodes);
+            pthread_t threads[num_threads];
+            append_data_t data = {.head = &head, .num_nodes = num_nodes / num_threads, .insert = inserts[k]};
+
+            struct timespec start_time, end_time;
+            clock_gettime(CLOCK_MONOTONIC, &start_time);
+            for (int t = 0; t < num_threads; t++)
+            {
+                pthread_create(&threads[t], NULL, thread_append_function, &data);
+            }
+            for (int t = 0; t < num_threads; t++)
+            {
+                pthread_join(threads[t], NULL);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &end_time);
+
+            long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+            my_assert(list_count_nodes(&head) == num_nodes);
+            printf("    threads: %3d\t%-14s\ttime: %9ld microseconds\n", num_threads, names[k], micros);
+            list_cleanup(&head);
+        }
+    }
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Benchmark: membership lookups, half of them misses, with list_search, which compares one value
+ * per node it hops to, against ulist_search over cache-line nodes with each search kernel the
+ * CPU supports.
+ */
+void benchmark_search(int num_nodes, int num_searches)
+{
+    printf_yellow("  Benchmarking %d searches in %d values:\n", num_searches, num_nodes);
+    uint16_t keys[num_searches];
+    for (int i = 0; i < num_searches; i++)
+    {
+        keys[i] = rand() % (2 * num_nodes);
+    }
+    struct timespec start_time, end_time;
+
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * num_nodes);
+    for (int i = 0; i < num_nodes; i++)
+    {
+        list_insert(&head, i);
+    }
+    int found = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (int i = 0; i < num_searches; i++)
+    {
+        found += list_search(&head, keys[i]) != NULL;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    long list_micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+    printf("    %-24s\ttime: %9ld microseconds\n", "list_search", list_micros);
+    list_cleanup(&head);
+
+    char *names[] = {"auto", "ulist_search scalar", "ulist_search SSE2", "ulist_search AVX2"};
+    ulist_t *list = ulist_create(num_nodes);
+    for (int i = 0; i < num_nodes; i++)
+    {
+        ulist_insert(list, i);
+    }
+    for (ulist_search_t kernel = ULIST_SEARCH_SCALAR; kernel <= ULIST_SEARCH_AVX2; kernel++)
+    {
+        if (ulist_use_search(kernel) != kernel)
+        {
+            printf("    %-24s\tnot supported by this CPU\n", names[kernel]);
+            continue;
+        }
+        int ulist_found = 0;
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        for (int i = 0; i < num_searches; i++)
+        {
+            ulist_found += ulist_search(list, keys[i]) >= 0;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_nsec - start_time.tv_nsec) / 1000;
+        my_assert(ulist_found == found);
+        printf("    %-24s\ttime: %9ld microseconds\t%.1fx list_search\n", names[kernel], micros, (double)list_micros / (micros > 0 ? micros : 1));
+    }
+    ulist_use_search(ULIST_SEARCH_AUTO);
+    ulist_destroy(list);
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Report: bytes a list spends per node, against the layout with a pthread_mutex_t in every node
+ * and against the unrolled list, which packs a cache line of values into one allocation.
+ * The pool figures include the slab's rounding and whatever the list's pool keeps for itself.
+ */
+typedef struct
+{
+    uint16_t data;
+    void *next;
+    pthread_mutex_t lock;
+} mutex_node_t;
+
+void report_node_memory(int num_nodes)
+{
+    printf_yellow("  Memory per node (%d nodes):\n", num_nodes);
+    Node *head = NULL;
+    list_init(&head, sizeof(Node) * num_nodes);
+    for (int i = 0; i < num_nodes; i++)
+    {
+        list_insert(&head, i);
+    }
+    mem_stats_t stats = list_memory_stats(&head);
+    my_assert(list_count_nodes(&head) == num_nodes);
+    printf("    sizeof(Node): %zu bytes\t%zu nodes per cache line\tpool: %.1f bytes per node\n",
+           sizeof(Node), MEM_CACHE_LINE / sizeof(Node), (double)stats.in_use / num_nodes);
+    printf("    with a pthread_mutex_t per node: %zu bytes\t%zu nodes per cache line\n",
+           sizeof(mutex_node_t), MEM_CACHE_LINE / sizeof(mutex_node_t));
+    list_cleanup(&head);
+
+    ulist_t *list = ulist_create(num_nodes);
+    for (int i = 0; i < num_nodes; i++)
+    {
+        ulist_insert(list, i);
+    }
+    stats = mem_pool_stats(list->pool);
+    printf("    unrolled list: %zu values per %zu-byte node\t%zu nodes\tpool: %.1f bytes per value\n",
+           ULIST_NODE_VALUES, sizeof(UNode), ulist_node_count(list), (double)stats.in_use / num_nodes);
+    ulist_destroy(list);
+    printf_green("  ... [DONE].\n");
+}
+
 // Main function to run all tests
 int main(int argc, char *argv[])
 {
@@ -670,6 +1231,10 @@ int main(int argc, char *argv[])
         printf(" 6. test_list_insert_after - Test multiple insertions after a given node\n");
         printf(" 7. test_list_insert_after - Test multiple insertions after a given node\n");
         printf(" 8. test_list_delete - Test multiple detelions\n");
+        printf(" 9. profile the list locks and the memory manager's locks over the basic operations, dumped at exit and on SIGUSR1\n");
+        printf("10. benchmark list_insert against appending by walking from the head, 2^14 nodes\n");
+        printf("11. report memory per node\n");
+        printf("12. benchmark list_search against ulist_search with each SIMD kernel, 2^14 values\n");
         printf(" 0. Run all tests\n");
         return 1;
     }
@@ -685,6 +1250,23 @@ int main(int argc, char *argv[])
         test_list_insert_after_multithread(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
         test_list_insert_before_multithreaded(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
         test_list_delete_multithreaded(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
+        test_list_delete();
+        test_list_search();
+        test_list_count_nodes();
+        test_list_cleanup();
+        test_list_insert_loop(1024);
+        test_list_insert_after_loop(1024);
+        test_list_delete_loop(1024);
+        test_list_search_loop(1024);
+        test_list_edge_cases();
+        test_list_insert_bulk(1024);
+        test_list_insert_bulk_multithread(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
+        test_list_read_multithread(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
+        test_list_independent(1024);
+        test_ulist_operations(1024);
+        test_ulist_multithread(&(TestParams){.num_threads = base_num_threads, .num_nodes = 1024});
+        test_ulist_search_kernels(1024);
+        report_node_memory(1024);
 
         printf("\nStress testing basic operations with various numbers of threads and nodes:\n");
         for (int i = 0; i < 9; i++)      // from 2^0 = 1 up to 2^8 = 256 threads
@@ -730,6 +1312,30 @@ int main(int argc, char *argv[])
                 test_list_delete_multithreaded(&(TestParams){.num_threads = pow(2, i), .num_nodes = pow(2, j)});
         break;
 
+    case 9:
+        mem_lock_profile(1);
+        mem_lock_dump_at_exit(SIGUSR1);
+        for (int i = 2; i < 9; i += 2) // 4 up to 256 threads
+        {
+            test_list_insert_multithread(&(TestParams){.num_threads = pow(2, i), .num_nodes = 4096});
+            test_list_insert_before_multithreaded(&(TestParams){.num_threads = pow(2, i), .num_nodes = 4096});
+            test_list_delete_multithreaded(&(TestParams){.num_threads = pow(2, i), .num_nodes = 4096});
+        }
+        break;
+
+    case 10:
+        printf("\n*** Append benchmark: ***\n");
+        benchmark_append((int)pow(2, 14));
+        break;
+
+    case 11:
+        report_node_memory((int)pow(2, 14));
+        break;
+
+    case 12:
+        benchmark_search((int)pow(2, 14), 2000);
+        break;
+
     default:
         printf("Invalid test function\n");
         break;
@@ -22,6 +22,23 @@
 
 my_barrier_t barrier; // Declare our custom barrier
 
+// Engine mem_init sets up, the buddy test target builds with -DMEM_DEFAULT_ENGINE=MEM_ENGINE_BUDDY
+#ifndef MEM_DEFAULT_ENGINE
+#define MEM_DEFAULT_ENGINE MEM_ENGINE_BLOCK_LIST
+#endif
+
+/*
+ * Some tests expect a pool to hold blocks that add up to its size exactly. The buddy engine
+ * rounds every block up to a power of two, so those tests are skipped when it is the default.
+ */
+bool exact_fit(const char *name)
+{
+    if (MEM_DEFAULT_ENGINE != MEM_ENGINE_BUDDY)
+        return true;
+    printf_yellow("  Skipping \"%s\", buddy blocks are rounded up to powers of two.\n", name);
+    return false;
+}
+
 // Data structure to pass arguments to threads
 typedef struct
 {
@@ -454,7 +471,9 @@ void *cumulative_alloc(void *arg)
         if (blocks[i] == NULL)
         {
             // if (debug)
-            printf_yellow("    Allocation failed as expected for size %zu in thread %d\n", block_size, data->thread_id);
+            mem_fragmentation_t fragmentation = mem_fragmentation();
+            printf_yellow("    Allocation failed as expected for size %zu in thread %d (free %zu, largest free %zu, fragmentation %.2f)\n",
+                          block_size, data->thread_id, fragmentation.free, fragmentation.largest_free, fragmentation.index);
             returnval = 1; // Expected failure
             break;
         }
@@ -535,7 +554,11 @@ void *thread_overcommit_alloc(void *arg)
     if (initial_block == NULL)
     {
         if (debug)
-            printf_red("    Thread %d failed to allocate initial %zu bytes\n", data->thread_id, data->block_size);
+        {
+            mem_fragmentation_t fragmentation = mem_fragmentation();
+            printf_red("    Thread %d failed to allocate initial %zu bytes (free %zu, largest free %zu, fragmentation %.2f)\n",
+                       data->thread_id, data->block_size, fragmentation.free, fragmentation.largest_free, fragmentation.index);
+        }
         return (void *)1; // Indicate failure in initial allocation
     }
     if (debug)
@@ -802,7 +825,7 @@ void *thread_function(void *arg)
     for (int i = 0; i < num_allocations; i++)
     {
         // Allocate memory
-        blocks[i] = (char *)mem_alloc(block_size);
+        blocks[i] = (char *)mem_alloc_uninit(block_size); // Overwritten with the pattern below
         my_assert(blocks[i] != NULL); // Check allocation was successful
         // printf("Thread %d: Allocated block %d at %p = %d\n", thread_id, i, blocks[i], thread_id * num_allocations + i);
         // Write a unique pattern based on thread_id and index i
@@ -868,138 +891,1779 @@ void run_concurrency_test(TestParams params)
     printf_green("[PASS].\n");
 }
 
-/* repeated from A1, as there were solutions that has issues */
+/*
+ * Boundary-tag engine: payloads are 16-byte aligned, freed neighbours coalesce in both
+ * directions so the whole pool can be handed out again, and resize grows in place.
+ */
+void test_boundary_tag_engine()
+{
+    printf_yellow("  Testing boundary-tag engine ---> ");
+    size_t pool_size = 4096;
+    mem_init_config(pool_size, (mem_config_t){.engine = MEM_ENGINE_BOUNDARY_TAG});
+
+    char *block0 = mem_alloc(1000);
+    char *block1 = mem_alloc(1000);
+    char *block2 = mem_alloc(1000);
+    my_assert(block0 != NULL && block1 != NULL && block2 != NULL);
+    my_assert((uintptr_t)block0 % 16 == 0 && (uintptr_t)block1 % 16 == 0 && (uintptr_t)block2 % 16 == 0);
+    my_assert(block1 >= block0 + 1000 && block2 >= block1 + 1000);
+
+    memset(block1, 0x5A, 1000);
+    mem_free(block0);
+    mem_free(block2);
+    block1 = mem_resize(block1, 2000); // Grows into the freed successor
+    my_assert(block1 != NULL);
+    sanityCheck(1000, block1, 0x5A);
+    mem_free(block1);
 
-void test_looking_for_out_of_bounds()
+    // Everything coalesced: the pool minus prologue padding, header and epilogue fits in one block
+    void *whole = mem_alloc(pool_size - 24);
+    my_assert(whole != NULL);
+    my_assert(mem_alloc(0) == NULL);
+    mem_free(whole);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+/*
+ * mem_resize paths: shrink in place, grow forward into the freed rest, grow backward into a
+ * free predecessor, relocate inside the arena and, with the arena full, move to another one.
+ */
+void test_resize_paths(mem_engine_t engine, char *name)
 {
-    printf("  Testing outofbounds (errors not tracked/detected here) \n");
+    printf_yellow("  Testing mem_resize paths (%s) ---> ", name);
+    mem_init_config(2048, (mem_config_t){.engine = engine});
+
+    char *first = mem_alloc(128);
+    char *block = mem_alloc(128);
+    char *guard = mem_alloc(128);
+    my_assert(first != NULL && block != NULL && guard != NULL);
+    memset(block, 0xB, 128);
+
+    my_assert(mem_resize(block, 64) == block);
+    my_assert(mem_resize(block, 128) == block);
+    sanityCheck(64, block, 0xB); // Bytes cut off by the shrink are gone
+    memset(block, 0xB, 128);
+    mem_free(first);
+    char *moved = mem_resize(block, 200); // The guard blocks forward growth
+    my_assert(moved == first);
+    sanityCheck(128, moved, 0xB);
+    memset(moved, 0xC, 200);
+    block = mem_resize(moved, 800);
+    my_assert(block != NULL && block > guard);
+    sanityCheck(200, block, 0xC);
+
+    mem_resize_stats_t stats = mem_resize_stats();
+    my_assert(stats.in_place == 1 && stats.forward == 1 && stats.backward == 1);
+    my_assert(stats.relocated == 1 && stats.moved == 0);
+    mem_deinit();
 
-    printf("ALLOCATION 5000\n");
-    mem_init(5000); // Initialize with 1024 bytes
-    printf("ALLOCATED 5000\n");
-    void *block0 = mem_alloc(512); // Edge case: zero allocation
-    assert(block0 != NULL);        // Depending on handling, this could also be NULL
+    // Two arenas of 1024 bytes: a block that outgrows its arena moves to the other one
+    mem_init_config(2048, (mem_config_t){.engine = engine, .arena_count = 2});
+    block = mem_alloc(512);
+    guard = mem_alloc(256);
+    my_assert(block != NULL && guard != NULL);
+    memset(block, 0xD, 512);
+    moved = mem_resize(block, 900);
+    my_assert(moved != NULL && calculate_distance(moved, block) >= 512);
+    sanityCheck(512, moved, 0xD);
+    my_assert(mem_resize_stats().moved == 1);
+    mem_deinit();
 
-    void *block1 = mem_alloc(512); // 0-1024
-    assert(block1 != NULL);
+    printf_green("[PASS].\n");
+}
 
-    void *block2 = mem_alloc(1024); // 1024-2048
-    assert(block2 != NULL);
+/*
+ * Bulk allocation: blocks are carved from one run of memory and zeroed, the pool running out
+ * cuts the batch short, and a bulk free in any order merges everything back into one block.
+ */
+void test_bulk_alloc_free(mem_engine_t engine, char *name)
+{
+    printf_yellow("  Testing mem_alloc_bulk and mem_free_bulk (%s) ---> ", name);
+    size_t pool_size = 4096;
+    mem_init_config(pool_size, (mem_config_t){.engine = engine});
 
-    void *block3 = mem_alloc(2048); // 2048-4096
-    assert(block3 != NULL);
+    char *blocks[128];
+    my_assert(mem_alloc_bulk(64, 16, (void **)blocks) == 16);
+    for (int i = 0; i < 16; i++)
+    {
+        sanityCheck(64, blocks[i], 0);
+        memset(blocks[i], i, 64);
+        if (i > 0)
+            my_assert(blocks[i] > blocks[i - 1] && blocks[i] - blocks[i - 1] <= 80); // One run of memory
+    }
+    for (int i = 0; i < 16; i++)
+        sanityCheck(64, blocks[i], i);
 
-    void *block4 = mem_alloc(904); // 4096-5000
-    assert(block4 != NULL);
+    // Free every other block one by one, the rest in reverse order as a batch
+    for (int i = 0; i < 16; i += 2)
+        mem_free(blocks[i]);
+    char *rest[8];
+    for (int i = 0; i < 8; i++)
+        rest[i] = blocks[15 - 2 * i];
+    mem_free_bulk((void **)rest, 8);
 
-    printf("BLOCK0; %p, 512\n", block0);
-    printf("BLOCK1; %p, 512\n", block1);
-    printf("BLOCK2; %p, 1024\n", block2);
-    printf("BLOCK3; %p, 2048\n", block3);
-    printf("BLOCK4; %p, 904\n", block4);
+    size_t count = mem_alloc_bulk(64, 128, (void **)blocks);
+    my_assert(count >= 40 && count < 128); // The pool runs out
+    blocks[count] = NULL;                  // NULL entries are skipped
+    mem_free_bulk((void **)blocks, count + 1);
+
+    void *whole = mem_alloc(pool_size - 24);
+    my_assert(whole != NULL);
+    mem_free(whole);
 
-    mem_free(block0);
-    mem_free(block1);
     mem_deinit();
-    printf("[PASS].\n");
+    printf_green("[PASS].\n");
 }
 
-int main(int argc, char *argv[])
+/*
+ * mem_stats: usage, free space, block and call counts follow every operation, and a bump pool
+ * gets its block count back from a marker.
+ */
+void test_stats()
 {
-#ifdef VERSION
-    printf("Build Version; %s \n", VERSION);
-#endif
-    printf("Git Version; %s/%s \n", git_date, git_sha);
+    printf_yellow("  Testing mem_stats ---> ");
+    mem_init_config(4096, (mem_config_t){.engine = MEM_ENGINE_BLOCK_LIST});
+    mem_stats_t stats = mem_stats();
+    my_assert(stats.in_use == 0 && stats.free == 4096 && stats.largest_free == 4096 && stats.blocks == 0);
+
+    char *first = mem_alloc(100);
+    char *second = mem_alloc(100);
+    char *third = mem_alloc(100);
+    mem_free(second);
+    my_assert(mem_alloc(5000) == NULL);
+    third = mem_resize(third, 50);
+    stats = mem_stats();
+    my_assert(stats.in_use == 150 && stats.peak_in_use == 300 && stats.free == 4096 - 150);
+    my_assert(stats.largest_free == 4096 - 300 + 50 && stats.blocks == 2);
+    my_assert(stats.allocs == 4 && stats.failed_allocs == 1 && stats.frees == 1 && stats.resizes == 1);
+    mem_free(first);
+    mem_free(third);
+    mem_deinit();
 
-    if (argc < 2)
+    mem_init_config(4096, (mem_config_t){.engine = MEM_ENGINE_BOUNDARY_TAG});
+    first = mem_alloc(100);
+    stats = mem_stats();
+    my_assert(stats.blocks == 1 && stats.in_use >= 100 && stats.in_use + stats.free == mem_resident_size());
+    mem_free(first);
+    my_assert(mem_stats().blocks == 0 && mem_stats().largest_free == mem_stats().free);
+    mem_deinit();
+
+    mem_init_config(4096, (mem_config_t){.engine = MEM_ENGINE_BUMP});
+    mem_alloc(64);
+    mem_marker_t *marker = mem_mark();
+    mem_alloc(64);
+    mem_alloc(64);
+    my_assert(mem_stats().blocks == 3);
+    mem_reset_to(marker);
+    my_assert(mem_stats().blocks == 1 && mem_stats().in_use == 64);
+    mem_deinit();
+
+    printf_green("[PASS].\n");
+}
+
+/*
+ * mem_fragmentation: freeing every other block leaves holes that show up in the histogram and
+ * the ratio, and the dump reports them as one JSON line.
+ */
+void test_fragmentation()
+{
+    printf_yellow("  Testing mem_fragmentation ---> ");
+    mem_init_config(4096, (mem_config_t){.engine = MEM_ENGINE_BLOCK_LIST});
+    mem_fragmentation_t fragmentation = mem_fragmentation();
+    my_assert(fragmentation.index == 0 && fragmentation.free_blocks == 1 && fragmentation.histogram[12] == 1);
+
+    char *blocks[8];
+    for (int i = 0; i < 8; i++)
     {
-        printf("Usage: %s <test function>\n", argv[0]);
-        printf("Available test functions:\n");
+        blocks[i] = mem_alloc(256);
+    }
+    for (int i = 0; i < 8; i += 2)
+    {
+        mem_free(blocks[i]);
+    }
+    fragmentation = mem_fragmentation();
+    my_assert(fragmentation.free == 3072 && fragmentation.largest_free == 2048 && fragmentation.free_blocks == 5);
+    my_assert(fragmentation.histogram[8] == 4 && fragmentation.histogram[11] == 1);
+    my_assert(fragmentation.index > 0.33 && fragmentation.index < 0.34);
+
+    char line[1024] = "";
+    FILE *out = tmpfile();
+    mem_dump(out);
+    rewind(out);
+    my_assert(fgets(line, sizeof(line), out) != NULL);
+    fclose(out);
+    my_assert(line[0] == '{' && strstr(line, "\"free_histogram\": {\"256\": 4, \"2048\": 1}}") != NULL);
+
+    for (int i = 1; i < 8; i += 2)
+    {
+        mem_free(blocks[i]);
+    }
+    fragmentation = mem_fragmentation();
+    my_assert(fragmentation.index == 0 && fragmentation.free_blocks == 1 && fragmentation.largest_free == 4096);
+    mem_deinit();
 
-        printf("  0. tests various functions with a base number of threads\n");
-        printf("  1. tests various functions across variious configurations (number of threads, memory sizes,  iterations)\n");
-        printf("  2. stress tests various functions with various configurations. This may take some time (especially if simulate_work flag is set to true.\n");
-        printf("  3. test_looking_for_out_of_bounds, needs LD_PRELOAD=./libmymalloc.so .\n\n");
-        return 1;
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Lock profiling: every arena lock taken by mem_alloc, mem_free and mem_resize is counted at its
+ * site, and a lock held by another thread shows up as a contended acquisition with its wait.
+ */
+static pthread_mutex_t profiled_lock = PTHREAD_MUTEX_INITIALIZER;
+
+void *profiled_lock_waiter(void *arg)
+{
+    (void)arg;
+    mem_lock_acquire(&profiled_lock, MEM_LOCK_LIST_READ);
+    mem_lock_release(&profiled_lock, MEM_LOCK_LIST_READ);
+    return NULL;
+}
+
+void test_lock_profile()
+{
+    printf_yellow("  Testing lock profiling ---> ");
+    mem_init_config(4096, (mem_config_t){.engine = MEM_ENGINE_BLOCK_LIST});
+    mem_free(mem_alloc(64)); // Taken before profiling is enabled, not counted
+
+    mem_lock_profile(1);
+    char *first = mem_alloc(64);
+    char *second = mem_alloc(64);
+    second = mem_resize(second, 32);
+    mem_free(first);
+    mem_free(second);
+    mem_lock_stats_t alloc = mem_lock_stats(MEM_LOCK_ALLOC);
+    my_assert(alloc.acquisitions == 2 && alloc.contended == 0 && alloc.wait_ns == 0);
+    my_assert(mem_lock_stats(MEM_LOCK_FREE).acquisitions == 2 && mem_lock_stats(MEM_LOCK_RESIZE).acquisitions == 1);
+    my_assert(mem_lock_stats(MEM_LOCK_LIST_INSERT).acquisitions == 0);
+
+    pthread_t waiter;
+    mem_lock_acquire(&profiled_lock, MEM_LOCK_LIST_READ);
+    pthread_create(&waiter, NULL, profiled_lock_waiter, NULL);
+    usleep(20000); // Hold the lock long enough for the waiter to block on it
+    mem_lock_release(&profiled_lock, MEM_LOCK_LIST_READ);
+    pthread_join(waiter, NULL);
+    mem_lock_stats_t read = mem_lock_stats(MEM_LOCK_LIST_READ);
+    my_assert(read.acquisitions == 2 && read.contended == 1 && read.wait_ns > 0 && read.max_wait_ns == read.wait_ns);
+    my_assert(read.hold_ns >= 20000000 && read.max_hold_ns >= 20000000);
+
+    char line[2048] = "";
+    FILE *out = tmpfile();
+    mem_lock_dump(out);
+    rewind(out);
+    my_assert(fgets(line, sizeof(line), out) != NULL);
+    fclose(out);
+    my_assert(strstr(line, "{\"alloc\": {\"acquisitions\": 2, \"contended\": 0,") == line);
+    my_assert(strstr(line, "\"list_read\": {\"acquisitions\": 2") != NULL);
+
+    mem_lock_profile(0);
+    mem_free(mem_alloc(64));
+    my_assert(mem_lock_stats(MEM_LOCK_ALLOC).acquisitions == 2);
+    mem_deinit();
+
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Epoch-based reclamation: a retired block stays allocated while a thread that entered before it
+ * was retired is still inside, and goes back to the pool once that thread has left. Blocks
+ * retired by many threads at once all come back, at the latest with mem_ebr_destroy.
+ */
+typedef struct
+{
+    mem_ebr_t *ebr;
+    mem_pool_t *pool;
+    my_barrier_t *entered;
+    my_barrier_t *retired;
+    int iterations;
+} ebr_data_t;
+
+void *ebr_reader(void *arg)
+{
+    ebr_data_t *data = (ebr_data_t *)arg;
+    mem_ebr_enter(data->ebr);
+    my_barrier_wait(data->entered);
+    my_barrier_wait(data->retired);
+    mem_ebr_exit(data->ebr);
+    return NULL;
+}
+
+void *ebr_retirer(void *arg)
+{
+    ebr_data_t *data = (ebr_data_t *)arg;
+    for (int i = 0; i < data->iterations; i++)
+    {
+        mem_ebr_enter(data->ebr);
+        void *block = mem_pool_alloc(data->pool, 16);
+        mem_ebr_exit(data->ebr);
+        mem_ebr_retire(data->ebr, block);
     }
+    return NULL;
+}
 
-    // used for case 19
-    int base_num_threads = 4;
-    int allocs;
-    size_t blockSize;
-    bool simulate_work = false; // set this to true to see the benefits of multithreading
+void test_ebr(int num_threads)
+{
+    printf_yellow("  Testing epoch-based reclamation (threads: %d) ---> ", num_threads);
+    mem_pool_t *pool = mem_pool_create(64 * 1024);
+    mem_ebr_t *ebr = mem_pool_ebr_create(pool);
+    my_barrier_t entered, retired;
+    my_barrier_init(&entered, 2);
+    my_barrier_init(&retired, 2);
+    ebr_data_t data = {.ebr = ebr, .pool = pool, .entered = &entered, .retired = &retired};
+
+    pthread_t reader;
+    pthread_create(&reader, NULL, ebr_reader, &data);
+    my_barrier_wait(&entered);
+    mem_ebr_retire(ebr, mem_pool_alloc(pool, 64));
+    for (int i = 0; i < 4; i++)
+    {
+        mem_ebr_flush(ebr);
+    }
+    my_assert(mem_pool_stats(pool).blocks == 1); // The reader may still hold it
+    my_barrier_wait(&retired);
+    pthread_join(reader, NULL);
+    for (int i = 0; i < 2; i++)
+    {
+        mem_ebr_flush(ebr);
+    }
+    my_assert(mem_pool_stats(pool).blocks == 0);
 
-    switch (atoi(argv[1]))
+    pthread_t threads[num_threads];
+    data.iterations = 1000;
+    for (int i = 0; i < num_threads; i++)
     {
-    case -1:
-        printf("No tests will be executed.\n");
-        break;
-    case 0:
-        // Running all tests with a base number of threads
-        printf("\n*** Testing various functions with a base number of threads: ***\n");
-        run_concurrent_test(test_alloc_and_free, (TestParams){.num_threads = base_num_threads, .memory_size = 1024}, "mem_alloc and mem_free");
-        run_concurrent_test(test_zero_alloc_and_free, (TestParams){.num_threads = base_num_threads, .memory_size = 1024}, "zero alloc and free");
+        pthread_create(&threads[i], NULL, ebr_retirer, &data);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    my_assert(mem_pool_stats(pool).blocks < (size_t)num_threads * data.iterations); // Batches were released on the way
+    mem_ebr_destroy(ebr);
+    my_assert(mem_pool_stats(pool).blocks == 0);
 
-        test_resize_multithread((TestParams){.num_threads = base_num_threads});
+    my_barrier_destroy(&entered);
+    my_barrier_destroy(&retired);
+    mem_pool_destroy(pool);
+    printf_green("[PASS].\n");
+}
 
-        test_exceed_single_allocation_multithread((TestParams){.num_threads = base_num_threads});
-        test_exceed_cumulative_allocation_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 1024}); // TODO: Fix this to be able to run with various configurations
+/*
+ * Thread caches: alloc/free pairs of small blocks should mostly hit the calling thread's cache,
+ * and the blocks cached by a thread must be back in the pool once it has exited.
+ */
+void *thread_cached_pairs(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+    void *blocks[4];
 
-        test_memory_overcommit_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 1024});
+    for (int i = 0; i < data->iterations; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            blocks[j] = mem_alloc(data->block_size);
+            my_assert(blocks[j] != NULL);
+            memset(blocks[j], data->thread_id, data->block_size);
+        }
+        for (int j = 0; j < 4; j++)
+        {
+            sanityCheck(data->block_size, blocks[j], data->thread_id);
+            mem_free(blocks[j]);
+        }
+    }
+    return NULL;
+}
 
-        for (int i = 0; i < 4; i++)
-            test_repeated_fit_reuse_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 1024, .iterations = pow(10, i)});
+void test_tcache_multithread(TestParams params)
+{
+    printf_yellow("  Testing thread caches (threads: %d, mem_size: %zu, iterations: %d) ---> ", params.num_threads, params.memory_size, params.iterations);
 
-        test_memory_fragmentation_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 2048});
-        test_random_blocks_multithread((TestParams){.num_threads = base_num_threads, .block_size = 1024});
+    pthread_t threads[params.num_threads];
+    thread_data_t params_t[params.num_threads];
+    mem_init_config(params.memory_size, (mem_config_t){.tcache_depth = 8});
 
-        break;
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        params_t[i].thread_id = i;
+        params_t[i].block_size = 64;
+        params_t[i].iterations = params.iterations;
+        pthread_create(&threads[i], NULL, thread_cached_pairs, &params_t[i]);
+    }
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
 
-    case 1:
-        printf("\n*** Testing various functions across variious configurations (number of threads, memory sizes,  iterations): ***\n");
-        testAcrossConfigurations(test_resize_multithread, (TestParams){.memory_size = 1024});
-        testAcrossConfigurations(test_exceed_single_allocation_multithread, (TestParams){.memory_size = 1024});
+    mem_tcache_stats_t stats = mem_tcache_stats();
+    my_assert(stats.hits + stats.misses == (uint64_t)params.num_threads * params.iterations * 4);
+    my_assert(stats.hits > stats.misses);
 
-        for (int i = 1; i < 6; i++)
-            test_exceed_cumulative_allocation_multithread((TestParams){.num_threads = pow(2, i), .memory_size = pow(2, 11 + i)});
-        break;
-        testAcrossConfigurations(test_memory_overcommit_multithread, (TestParams){.memory_size = 1024});
-        testAcrossConfigurations(test_repeated_fit_reuse_multithread, (TestParams){.iterations = 1});
-        testAcrossConfigurations(test_memory_fragmentation_multithread, (TestParams){.iterations = 1});
-        testAcrossConfigurations(test_random_blocks_multithread, (TestParams){.memory_size = 1024, .block_size = 1024});
+    // Exited threads flushed their caches, so the pool coalesced back into one block
+    void *whole = mem_alloc(params.memory_size);
+    my_assert(whole != NULL);
+    mem_free(whole);
 
-        break;
-    case 2:
-        printf("\n*** Scalability testing: ***\n");
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
 
-        printf("Testing mem_alloc and mem_free\n");
+/*
+ * Thread caches against stale frees: a block freed twice, whether it still sits in the cache
+ * or has been flushed back to its arena, and an interior pointer on a 16-byte boundary must
+ * not be cached and handed out again. Every block live at the end has to own its bytes.
+ */
+void test_tcache_double_free(mem_engine_t engine, char *name)
+{
+    printf_yellow("  Testing thread caches against double and interior frees (%s) ---> ", name);
+    mem_pool_t *pool = mem_pool_create_config(64 * 1024, (mem_config_t){.engine = engine, .tcache_depth = 4});
+    char *blocks[64];
+
+    char *block = mem_pool_alloc(pool, 32);
+    mem_pool_free(pool, block);
+    mem_pool_free(pool, block);
+    char *first = mem_pool_alloc(pool, 32);
+    char *second = mem_pool_alloc(pool, 32);
+    my_assert(first != NULL && second != NULL && first != second);
+    mem_pool_free(pool, first);
+    mem_pool_free(pool, second);
+
+    // The cache holds 4 blocks per class, most of these go back to the arena before the second round
+    for (int i = 0; i < 64; i++)
+    {
+        blocks[i] = mem_pool_alloc(pool, 32);
+    }
+    for (int round = 0; round < 2; round++)
+    {
+        for (int i = 0; i < 64; i++)
+        {
+            mem_pool_free(pool, blocks[i]);
+        }
+    }
 
-        for (int i = 1; i < 4; i++)
+    char *large = mem_pool_alloc(pool, 256);
+    my_assert(large != NULL);
+    if (engine != MEM_ENGINE_BOUNDARY_TAG) // Boundary tags can't tell a header from payload bytes
+    {
+        for (int offset = 16; offset < 256; offset += 16)
         {
-            for (int j = 1; j < 5; j++)
-            {
-                run_concurrent_test(test_alloc_and_free, (TestParams){.num_threads = i, .memory_size = pow(2, 9 + j)}, "mem_alloc and mem_free");
-            }
+            mem_pool_free(pool, large + offset);
         }
+    }
+    memset(large, 0xAA, 256);
+    for (int i = 0; i < 64; i++)
+    {
+        blocks[i] = mem_pool_alloc(pool, 32);
+        my_assert(blocks[i] != NULL);
+        memset(blocks[i], i, 32);
+    }
 
-        printf("Testing random blocks\n");
-        for (int i = 2; i < 6; i++)
+    for (int i = 0; i < 64; i++)
+    {
+        for (int k = 0; k < 32; k++)
         {
-            test_random_blocks_multithread((TestParams){.num_threads = pow(2, i), .block_size = 1024});
+            my_assert(blocks[i][k] == i);
+        }
+    }
+    for (int k = 0; k < 256; k++)
+    {
+        my_assert((unsigned char)large[k] == 0xAA);
+    }
+    mem_pool_destroy(pool);
+    printf_green("[PASS].\n");
+}
+
+/*
+ * The same stale free through mem_free_bulk: a block already sitting in the thread cache must
+ * not also go back to its arena, or the cache and the arena both hand it out.
+ */
+void test_tcache_double_free_bulk(mem_engine_t engine, char *name)
+{
+    printf_yellow("  Testing thread caches against a mem_free followed by mem_free_bulk (%s) ---> ", name);
+    mem_pool_t *pool = mem_pool_create_config(64 * 1024, (mem_config_t){.engine = engine, .tcache_depth = 4});
+    char *blocks[8];
+
+    char *block = mem_pool_alloc(pool, 32);
+    mem_pool_free(pool, block);
+    void *again[1] = {block};
+    mem_pool_free_bulk(pool, again, 1);
+    my_assert(again[0] == NULL);
+
+    for (int i = 0; i < 8; i++)
+    {
+        blocks[i] = mem_pool_alloc(pool, 32);
+        my_assert(blocks[i] != NULL);
+        memset(blocks[i], i, 32);
+    }
+    for (int i = 0; i < 8; i++)
+    {
+        for (int k = 0; k < 32; k++)
+        {
+            my_assert(blocks[i][k] == i);
         }
+    }
+    mem_pool_destroy(pool);
+    printf_green("[PASS].\n");
+}
 
-        allocs = (int)pow(2, 15);
-        blockSize = (int)pow(2, 7);
-        // run_concurrency_test(1, 3, 100);
+/*
+ * Arenas: every thread allocates from its own slice of the pool while the main thread frees
+ * all blocks, each block has to go back to the arena it came from so that every arena
+ * coalesces into a single block again.
+ */
+void **arena_blocks; // Blocks allocated by the threads, num_blocks per thread
 
-        printf("Testing large number of blocks of fixed size\n");
-        for (int i = 0; i < 9; i++)
-            run_concurrency_test((TestParams){.num_threads = pow(2, i), .num_blocks = allocs, .block_size = blockSize, .simulate_work = simulate_work});
-        break;
+void *thread_arena_alloc(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
 
-    case 3:
-        printf("Test 3.\n");
-        test_looking_for_out_of_bounds();
+    for (int i = 0; i < data->num_blocks; i++)
+    {
+        char *block = mem_alloc(data->block_size);
+        my_assert(block != NULL);
+        memset(block, data->thread_id, data->block_size);
+        arena_blocks[data->thread_id * data->num_blocks + i] = block;
+    }
+    return NULL;
+}
+
+void test_arenas_multithread(TestParams params)
+{
+    size_t arena_count = 4;
+    printf_yellow("  Testing %zu arenas (threads: %d, mem_size: %zu) ---> ", arena_count, params.num_threads, params.memory_size);
+
+    pthread_t threads[params.num_threads];
+    thread_data_t params_t[params.num_threads];
+    int blocks_per_thread = params.memory_size / params.block_size / params.num_threads;
+    arena_blocks = malloc(params.num_threads * blocks_per_thread * sizeof(void *));
+    my_assert(arena_blocks != NULL);
+    mem_init_config(params.memory_size, (mem_config_t){.arena_count = arena_count});
+
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        params_t[i].thread_id = i;
+        params_t[i].block_size = params.block_size;
+        params_t[i].num_blocks = blocks_per_thread;
+        pthread_create(&threads[i], NULL, thread_arena_alloc, &params_t[i]);
+    }
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // The pool is used up exactly, whichever arenas the blocks came from
+    my_assert(mem_alloc(1) == NULL);
+    for (int i = 0; i < params.num_threads * blocks_per_thread; i++)
+    {
+        sanityCheck(params.block_size, arena_blocks[i], i / blocks_per_thread);
+        mem_free(arena_blocks[i]);
+    }
+
+    // Each arena is a single free block again, but no block spans two arenas
+    void *whole[arena_count];
+    for (size_t i = 0; i < arena_count; i++)
+    {
+        whole[i] = mem_alloc(params.memory_size / arena_count);
+        my_assert(whole[i] != NULL);
+    }
+    my_assert(mem_alloc(1) == NULL);
+    for (size_t i = 0; i < arena_count; i++)
+    {
+        mem_free(whole[i]);
+    }
+    my_assert(mem_alloc(params.memory_size / arena_count + 1) == NULL);
+
+    mem_deinit();
+    free(arena_blocks);
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Slabs: threads pop and push objects concurrently without ever sharing one, afterwards
+ * every object is free again exactly once.
+ */
+mem_slab_t *test_slab;
+
+void *thread_slab_pairs(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+    char *objects[4];
+
+    for (int i = 0; i < data->iterations; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            objects[j] = mem_slab_alloc(test_slab);
+            my_assert(objects[j] != NULL);
+            memset(objects[j], data->thread_id, data->block_size);
+        }
+        for (int j = 0; j < 4; j++)
+        {
+            sanityCheck(data->block_size, objects[j], data->thread_id);
+            mem_slab_free(test_slab, objects[j]);
+        }
+    }
+    return NULL;
+}
+
+void test_slab_multithread(TestParams params)
+{
+    printf_yellow("  Testing slab (threads: %d, object size: %zu, iterations: %d) ---> ", params.num_threads, params.block_size, params.iterations);
+
+    pthread_t threads[params.num_threads];
+    thread_data_t params_t[params.num_threads];
+    size_t count = params.num_threads * 4;
+    mem_init(params.block_size * count);
+    my_assert(mem_slab_create(params.block_size, count + 1) == NULL); // Larger than the pool
+    test_slab = mem_slab_create(params.block_size, count);
+    my_assert(test_slab != NULL);
+
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        params_t[i].thread_id = i;
+        params_t[i].block_size = params.block_size;
+        params_t[i].iterations = params.iterations;
+        pthread_create(&threads[i], NULL, thread_slab_pairs, &params_t[i]);
+    }
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Every object can be handed out once more, and no object twice
+    char *objects[count];
+    for (size_t i = 0; i < count; i++)
+    {
+        objects[i] = mem_slab_alloc(test_slab);
+        my_assert(objects[i] != NULL);
+        for (size_t j = 0; j < i; j++)
+        {
+            my_assert(objects[i] != objects[j]);
+        }
+    }
+    my_assert(mem_slab_alloc(test_slab) == NULL);
+
+    mem_slab_destroy(test_slab);
+    void *whole = mem_alloc(params.block_size * count); // The slab's memory is back in the pool
+    my_assert(whole != NULL);
+    mem_free(whole);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+/*
+ * mem_calloc zeroes reused memory and rejects overflowing sizes, mem_alloc_uninit leaves it alone.
+ */
+void test_calloc_and_uninit()
+{
+    printf_yellow("  Testing mem_calloc and mem_alloc_uninit ---> ");
+    mem_init(1024);
+
+    my_assert(mem_calloc(SIZE_MAX / 2, 4) == NULL);
+
+    char *block = mem_alloc_uninit(1024);
+    my_assert(block != NULL);
+    memset(block, 0xAB, 1024);
+    mem_free(block);
+
+    char *zeroed = mem_calloc(64, 16);
+    my_assert(zeroed == block);
+    sanityCheck(1024, zeroed, 0);
+    mem_free(zeroed);
+    mem_deinit();
+
+    // Zeroing under the arena lock instead of after it
+    mem_init_config(1024, (mem_config_t){.zero_in_lock = 1, .tcache_depth = 8});
+    block = mem_alloc_uninit(1024);
+    memset(block, 0xAB, 1024);
+    mem_free(block);
+    zeroed = mem_alloc(1024);
+    my_assert(zeroed == block);
+    sanityCheck(1024, zeroed, 0);
+    mem_free(zeroed);
+
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Alignment: mem_alloc_aligned returns aligned blocks after odd-sized ones and its front gaps
+ * coalesce again, the alignment option rounds every block of the pool.
+ */
+void test_aligned_alloc(mem_engine_t engine)
+{
+    printf_yellow("  Testing aligned allocation (engine: %d) ---> ", engine);
+    mem_init_config(4096, (mem_config_t){.engine = engine});
+
+    char *odd = mem_alloc(3);
+    my_assert(odd != NULL);
+    my_assert(mem_alloc_aligned(16, 48) == NULL); // Not a power of two
+    for (size_t alignment = 32; alignment <= 512; alignment *= 2)
+    {
+        char *block = mem_alloc_aligned(100, alignment);
+        my_assert(block != NULL);
+        my_assert((uintptr_t)block % alignment == 0);
+        sanityCheck(100, block, 0);
+        memset(block, 0xCD, 100);
+        sanityCheck(3, odd, 0); // The gap must not overlap earlier blocks
+        mem_free(block);
+    }
+    mem_free(odd);
+    void *whole = mem_alloc(engine == MEM_ENGINE_BLOCK_LIST ? 4096 : 4096 - 64);
+    my_assert(whole != NULL);
+    mem_free(whole);
+    mem_deinit();
+
+    mem_init_config(4096, (mem_config_t){.engine = engine, .alignment = MEM_CACHE_LINE});
+    char *first = mem_alloc(1);
+    char *second = mem_alloc(1);
+    my_assert(first != NULL && second != NULL);
+    my_assert((uintptr_t)first % MEM_CACHE_LINE == 0 && (uintptr_t)second % MEM_CACHE_LINE == 0);
+    my_assert(calculate_distance(first, second) >= MEM_CACHE_LINE);
+    second = mem_resize(second, 200);
+    my_assert(second != NULL && (uintptr_t)second % MEM_CACHE_LINE == 0);
+    mem_free(first);
+    mem_free(second);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Placement policies: with free blocks of 96, 400 and 200 bytes in front of the free tail,
+ * a 150-byte request lands in the 400-byte block (first fit), the tail (next fit) or the
+ * 200-byte block (best fit), and address-ordered best fit prefers the lower of two equal blocks.
+ */
+void test_placement_policies(mem_engine_t engine)
+{
+    printf_yellow("  Testing placement policies (engine: %d) ---> ", engine);
+    mem_placement_t policies[] = {MEM_FIT_FIRST, MEM_FIT_NEXT, MEM_FIT_BEST, MEM_FIT_ADDRESS_BEST};
+
+    for (int p = 0; p < 4; p++)
+    {
+        mem_init_config(4096, (mem_config_t){.engine = engine, .placement = policies[p]});
+        char *a = mem_alloc(96);
+        char *separators[4];
+        separators[0] = mem_alloc(16);
+        char *b = mem_alloc(400);
+        separators[1] = mem_alloc(16);
+        char *c = mem_alloc(200);
+        separators[2] = mem_alloc(16);
+        char *d = mem_alloc(96);
+        separators[3] = mem_alloc(16);
+        my_assert(a && b && c && d && separators[3]);
+
+        mem_free(b);
+        mem_free(c);
+        mem_free(a);
+        mem_free(d);
+
+        char *block = mem_alloc(150);
+        switch (policies[p])
+        {
+        case MEM_FIT_FIRST:
+            my_assert(block == b);
+            break;
+        case MEM_FIT_NEXT:
+            my_assert(block > separators[3]);
+            break;
+        case MEM_FIT_BEST:
+            my_assert(block == c);
+            break;
+        default:
+            my_assert(block == c);
+            my_assert(mem_alloc(96) == a); // d was freed last, so it heads the bin
+            break;
+        }
+
+        mem_deinit();
+    }
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Growable pool: allocations beyond the initial size map more memory up to max_size, and
+ * once the blocks are freed again the resident size falls back below the high watermark.
+ */
+void test_growable_pool(mem_engine_t engine)
+{
+    printf_yellow("  Testing growable pool (engine: %d) ---> ", engine);
+    size_t initial = 64 * 1024;
+    size_t high_watermark = 256 * 1024;
+    int count = 1024;
+    size_t block_size = 4096;
+    mem_init_config(initial, (mem_config_t){.engine = engine, .max_size = 16 * 1024 * 1024, .high_watermark = high_watermark, .low_watermark = 64 * 1024});
+    my_assert(mem_resident_size() >= initial);
+
+    char **blocks = malloc(count * sizeof(char *));
+    my_assert(blocks != NULL);
+    for (int i = 0; i < count; i++)
+    {
+        blocks[i] = mem_alloc(block_size);
+        my_assert(blocks[i] != NULL);
+        memset(blocks[i], i, block_size);
+    }
+    my_assert(mem_resident_size() >= count * block_size);
+    my_assert(mem_alloc(32 * 1024 * 1024) == NULL); // Beyond max_size
+
+    for (int i = 0; i < count; i++)
+    {
+        sanityCheck(block_size, blocks[i], (char)i);
+        mem_free(blocks[i]);
+    }
+    my_assert(mem_resident_size() <= initial + high_watermark);
+
+    // The pool grows again after trimming
+    blocks[0] = mem_alloc(2 * 1024 * 1024);
+    my_assert(blocks[0] != NULL);
+    mem_free(blocks[0]);
+
+    free(blocks);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Bump pools: allocations are carved in order, only mem_reset and markers give memory back,
+ * nested markers unwind in LIFO order and a growable bump pool shrinks again on reset.
+ */
+void test_bump_pool()
+{
+    printf_yellow("  Testing bump pool and markers ---> ");
+    mem_init_config(1024, (mem_config_t){.engine = MEM_ENGINE_BUMP});
+
+    char *a = mem_alloc(100);
+    char *b = mem_alloc(100);
+    my_assert(a != NULL && b == a + 100);
+    memset(a, 0xA, 100);
+    my_assert(mem_resize(b, 200) == b); // The most recent block grows in place
+    mem_free(a); // Only the most recent block can be freed
+    my_assert(mem_alloc(1) == b + 200);
+    mem_free(b + 200);
+    char *moved = mem_resize(a, 150);
+    my_assert(moved == b + 200);
+    sanityCheck(100, moved, 0xA);
+
+    mem_marker_t *outer = mem_mark();
+    my_assert(outer != NULL);
+    char *c = mem_alloc(64);
+    mem_marker_t *inner = mem_mark();
+    char *d = mem_alloc_aligned(32, 64);
+    my_assert(d != NULL && (uintptr_t)d % 64 == 0 && d > c);
+    mem_reset_to(inner);
+    my_assert(mem_alloc(1) == c + 64);
+    mem_reset_to(outer);
+    my_assert(mem_alloc(64) == moved + 150);
+    my_assert(mem_alloc(1024) == NULL);
+
+    mem_reset();
+    my_assert(mem_alloc(1024) == a);
+    mem_deinit();
+
+    // Growable: a reset hands committed memory back down to the high watermark
+    size_t high_watermark = 64 * 1024;
+    mem_init_config(4096, (mem_config_t){.engine = MEM_ENGINE_BUMP, .max_size = 4 * 1024 * 1024, .high_watermark = high_watermark});
+    mem_marker_t *start = mem_mark();
+    for (int i = 0; i < 256; i++)
+    {
+        char *block = mem_alloc(4096);
+        my_assert(block != NULL);
+        memset(block, i, 4096);
+    }
+    my_assert(mem_resident_size() >= 256 * 4096);
+    mem_reset_to(start);
+    my_assert(mem_resident_size() <= 4096 + high_watermark);
+    my_assert(mem_alloc(4096) == (char *)start);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Buddy engine: every request is one power-of-two block, shrinking and growing into a free
+ * buddy happen in place and freed blocks merge back into the whole region.
+ */
+void test_buddy_engine()
+{
+    printf_yellow("  Testing buddy engine ---> ");
+    mem_init_config(1024, (mem_config_t){.engine = MEM_ENGINE_BUDDY});
+
+    char *small = mem_alloc(100); // A 128-byte block
+    char *other = mem_alloc(200);
+    char *large = mem_alloc(500);
+    my_assert(small != NULL && other != NULL && large != NULL);
+    my_assert(mem_alloc(129) == NULL); // 128 bytes are left, a request isn't split over blocks
+    memset(small, 0xA, 100);
+    memset(other, 0xB, 200);
+    memset(large, 0xC, 500);
+
+    my_assert(mem_resize(large, 100) == large); // Shrinks in place
+    my_assert(mem_resize(small, 256) == small); // Takes its free buddy
+    mem_free(large);
+    char *moved = mem_resize(other, 300);
+    my_assert(moved != NULL && moved != other);
+    sanityCheck(100, small, 0xA);
+    sanityCheck(200, moved, 0xB);
+    mem_free(moved);
+    mem_free(small);
+
+    char *aligned = mem_alloc_aligned(16, 512);
+    my_assert(aligned != NULL && (uintptr_t)aligned % 512 == 0);
+    mem_free(aligned);
+    my_assert(mem_alloc(1024) == small); // Everything merged again
+    my_assert(mem_resident_size() == 1024);
+    mem_deinit();
+
+    mem_init_config(1000, (mem_config_t){.engine = MEM_ENGINE_BUDDY});
+    my_assert(mem_resident_size() == 1000);
+    my_assert(mem_alloc(1000) == NULL); // The largest block is 512 bytes
+    my_assert(mem_alloc(512) != NULL);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Pool handles: pools with different configurations next to the default pool, each one only
+ * frees its own blocks and is torn down without touching the others.
+ */
+mem_pool_t *test_pools[2];
+
+void *thread_pool_handles(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+    for (int i = 0; i < data->iterations; i++)
+    {
+        char *a = mem_pool_alloc(test_pools[0], data->block_size);
+        char *b = mem_pool_alloc(test_pools[1], data->block_size);
+        my_assert(a != NULL && b != NULL);
+        memset(a, 0xA, data->block_size);
+        memset(b, 0xB, data->block_size);
+        mem_pool_free(test_pools[0], b); // Not a block of this pool, ignored
+        sanityCheck(data->block_size, b, 0xB);
+        mem_pool_free(test_pools[1], b);
+        sanityCheck(data->block_size, a, 0xA);
+        mem_pool_free(test_pools[0], a);
+    }
+    return NULL;
+}
+
+void test_pool_handles(TestParams params)
+{
+    printf_yellow("  Testing pool handles (threads: %d) ---> ", params.num_threads);
+    mem_init(params.memory_size);
+    char *outside = mem_alloc(params.memory_size);
+    my_assert(outside != NULL);
+    memset(outside, 0xC, params.memory_size);
+
+    test_pools[0] = mem_pool_create(params.num_threads * params.block_size);
+    test_pools[1] = mem_pool_create_config(params.num_threads * params.block_size * 16, (mem_config_t){.engine = MEM_ENGINE_BOUNDARY_TAG, .tcache_depth = 4, .arena_count = 2});
+    my_assert(mem_pool_alloc(test_pools[0], params.num_threads * params.block_size + 1) == NULL);
+
+    pthread_t threads[params.num_threads];
+    thread_data_t data = {.block_size = params.block_size, .iterations = params.iterations};
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_create(&threads[i], NULL, thread_pool_handles, &data);
+    }
+    for (int i = 0; i < params.num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Everything went back to the first pool, the default pool is still full
+    void *whole = mem_pool_alloc(test_pools[0], params.num_threads * params.block_size);
+    my_assert(whole != NULL);
+    my_assert(mem_alloc(1) == NULL);
+    mem_pool_destroy(test_pools[0]);
+    my_assert(mem_pool_alloc(test_pools[1], params.block_size) != NULL);
+    mem_pool_destroy(test_pools[1]);
+
+    sanityCheck(params.memory_size, outside, 0xC);
+    mem_free(outside);
+    my_assert(mem_alloc(params.memory_size) == outside);
+    mem_deinit();
+    printf_green("[PASS].\n");
+}
+
+/*
+ * Benchmark: alloc/free pairs of small blocks with and without thread caches, across thread counts.
+ */
+void *thread_alloc_free_pairs(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+    void *blocks[4];
+
+    for (int i = 0; i < data->iterations; i++)
+    {
+        for (int j = 0; j < 4; j++)
+        {
+            blocks[j] = mem_alloc(data->block_size);
+        }
+        for (int j = 0; j < 4; j++)
+        {
+            mem_free(blocks[j]);
+        }
+    }
+    return NULL;
+}
+
+void benchmark_tcache(int total_pairs)
+{
+    size_t depths[] = {0, 16};
+    printf_yellow("  Benchmarking %d alloc/free pairs of 64 bytes with and without thread caches:\n", total_pairs);
+
+    for (int i = 0; i < 9; i++)
+    {
+        int num_threads = (int)pow(2, i);
+        for (int d = 0; d < 2; d++)
+        {
+            pthread_t threads[num_threads];
+            thread_data_t params_t[num_threads];
+            mem_init_config(num_threads * 64 * 64, (mem_config_t){.tcache_depth = depths[d]});
+
+            struct timeval start_time, end_time;
+            gettimeofday(&start_time, NULL);
+            for (int t = 0; t < num_threads; t++)
+            {
+                params_t[t].block_size = 64;
+                params_t[t].iterations = total_pairs / 4 / num_threads;
+                pthread_create(&threads[t], NULL, thread_alloc_free_pairs, &params_t[t]);
+            }
+            for (int t = 0; t < num_threads; t++)
+            {
+                pthread_join(threads[t], NULL);
+            }
+            gettimeofday(&end_time, NULL);
+
+            long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+            mem_tcache_stats_t stats = mem_tcache_stats();
+            printf("    threads: %3d\ttcache depth: %2zu\ttime: %8ld microseconds\thits: %8lu\tmisses: %6lu\n",
+                   num_threads, depths[d], micros, (unsigned long)stats.hits, (unsigned long)stats.misses);
+            mem_deinit();
+        }
+    }
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Benchmark: cost of mem_alloc while a growing number of blocks stays live.
+ * With size-class bins the cost should stay flat, a first-fit walk grows linearly with the block count.
+ * Only the allocations are timed, the blocks are freed again between the batches.
+ * Freeing all live blocks at the end is timed separately and should scale linearly.
+ */
+void benchmark_alloc_scaling(size_t block_size, int operations, mem_config_t config, char *engine_name)
+{
+    printf_yellow("  Benchmarking mem_alloc (%s) with %d allocations of %zu bytes per live block count:\n", engine_name, operations, block_size);
+
+    int batch = 64;
+    void *batch_blocks[batch];
+
+    for (int i = 10; i <= 15; i++)
+    {
+        int live_blocks = (int)pow(2, i);
+        void **blocks = malloc(live_blocks * sizeof(void *));
+        mem_init_config((live_blocks + batch) * (block_size + 32), config); // Leaves room for in-band headers
+
+        for (int j = 0; j < live_blocks; j++)
+        {
+            blocks[j] = mem_alloc(block_size);
+            my_assert(blocks[j] != NULL);
+        }
+
+        long micros = 0;
+        for (int done = 0; done < operations; done += batch)
+        {
+            struct timeval start_time, end_time;
+            gettimeofday(&start_time, NULL);
+            for (int j = 0; j < batch; j++)
+            {
+                batch_blocks[j] = mem_alloc(block_size);
+            }
+            gettimeofday(&end_time, NULL);
+            micros += (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+
+            for (int j = 0; j < batch; j++)
+            {
+                my_assert(batch_blocks[j] != NULL);
+                mem_free(batch_blocks[j]);
+            }
+        }
+        // Tear down in allocation order, the same pattern as thread_function and list_cleanup
+        struct timeval start_time, end_time;
+        gettimeofday(&start_time, NULL);
+        for (int j = 0; j < live_blocks; j++)
+        {
+            mem_free(blocks[j]);
+        }
+        gettimeofday(&end_time, NULL);
+        long free_micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+
+        printf("    live blocks: %6d\t%8.1f ns/alloc\tteardown: %8ld microseconds (%6.1f ns/free)\n",
+               live_blocks, micros * 1000.0 / operations, free_micros, free_micros * 1000.0 / live_blocks);
+        mem_deinit();
+        free(blocks);
+    }
+    printf_green("  ... [DONE].\n");
+}
+
+/* repeated from A1, as there were solutions that has issues */
+
+/*
+ * Benchmark: throughput of the concurrency test workload as the pool is split into more arenas.
+ */
+void benchmark_arenas(int allocs, size_t block_size)
+{
+    size_t arena_counts[] = {1, 2, 4, 8};
+    printf_yellow("  Benchmarking %d allocations of %zu bytes across arena counts:\n", allocs, block_size);
+
+    for (int i = 0; i < 9; i++)
+    {
+        int num_threads = (int)pow(2, i);
+        for (int a = 0; a < 4; a++)
+        {
+            pthread_t threads[num_threads];
+            thread_data_t params_t[num_threads];
+            mem_init_config(allocs * block_size, (mem_config_t){.arena_count = arena_counts[a]});
+
+            struct timeval start_time, end_time;
+            gettimeofday(&start_time, NULL);
+            for (int t = 0; t < num_threads; t++)
+            {
+                params_t[t].thread_id = t;
+                params_t[t].num_blocks = allocs / num_threads;
+                params_t[t].block_size = block_size;
+                params_t[t].simulate_work = false;
+                pthread_create(&threads[t], NULL, thread_function, &params_t[t]);
+            }
+            for (int t = 0; t < num_threads; t++)
+            {
+                pthread_join(threads[t], NULL);
+            }
+            gettimeofday(&end_time, NULL);
+            mem_deinit();
+
+            long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+            printf("    threads: %3d\tarenas: %zu\ttime: %8ld microseconds\t%10.0f ops/s\n",
+                   num_threads, arena_counts[a], micros, 2.0 * allocs * 1000000 / (micros > 0 ? micros : 1));
+        }
+    }
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Benchmark: callers that fill their blocks anyway. mem_alloc zeroing under the arena lock, as
+ * it did before mem_alloc_uninit existed, against mem_alloc zeroing after the lock is released
+ * and mem_alloc_uninit not zeroing at all. The arena lock hold and wait times come from the lock
+ * profile of the allocation site and show the critical section shrinking.
+ */
+bool bench_uninit; // Selects mem_alloc_uninit in thread_fill_pairs
+
+void *thread_fill_pairs(void *arg)
+{
+    thread_data_t *data = (thread_data_t *)arg;
+
+    for (int i = 0; i < data->iterations; i++)
+    {
+        char *block = bench_uninit ? mem_alloc_uninit(data->block_size) : mem_alloc(data->block_size);
+        my_assert(block != NULL);
+        memset(block, data->thread_id, data->block_size);
+        mem_free(block);
+    }
+    return NULL;
+}
+
+void benchmark_uninit(int total_pairs, size_t block_size)
+{
+    printf_yellow("  Benchmarking %d alloc/fill/free rounds of %zu bytes, zeroing in and after the arena lock and not at all:\n", total_pairs, block_size);
+    char *names[] = {"zero in lock", "mem_alloc", "mem_alloc_uninit"};
+
+    for (int i = 0; i < 9; i++)
+    {
+        int num_threads = (int)pow(2, i);
+        for (int u = 0; u < 3; u++)
+        {
+            pthread_t threads[num_threads];
+            thread_data_t params_t[num_threads];
+            bench_uninit = u == 2;
+            mem_init_config(num_threads * block_size, (mem_config_t){.zero_in_lock = u == 0});
+            mem_lock_profile(1);
+
+            struct timeval start_time, end_time;
+            gettimeofday(&start_time, NULL);
+            for (int t = 0; t < num_threads; t++)
+            {
+                params_t[t].thread_id = t;
+                params_t[t].block_size = block_size;
+                params_t[t].iterations = total_pairs / num_threads;
+                pthread_create(&threads[t], NULL, thread_fill_pairs, &params_t[t]);
+            }
+            for (int t = 0; t < num_threads; t++)
+            {
+                pthread_join(threads[t], NULL);
+            }
+            gettimeofday(&end_time, NULL);
+            mem_lock_profile(0);
+            mem_lock_stats_t lock = mem_lock_stats(MEM_LOCK_ALLOC);
+            mem_deinit();
+
+            long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+            printf("    threads: %3d\t%-16s\ttime: %8ld microseconds\tlock hold: %4.0f ns avg\tlock wait: %9.0f us in %6llu contended\n",
+                   num_threads, names[u], micros, (double)lock.hold_ns / (lock.acquisitions ? lock.acquisitions : 1),
+                   lock.wait_ns / 1000.0, (unsigned long long)lock.contended);
+        }
+    }
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Report: placement policies on the random-blocks workload (throughput) and on a churn of
+ * random-sized allocations and frees in a tight pool (failed allocations and fragmentation).
+ * Fragmentation is 1 - largest allocatable block / free bytes, measured with the churn's blocks still live.
+ */
+size_t largest_allocatable(size_t limit)
+{
+    size_t low = 0, high = limit;
+    while (low < high)
+    {
+        size_t mid = (low + high + 1) / 2;
+        void *block = mem_alloc_uninit(mid);
+        if (block != NULL)
+        {
+            mem_free(block);
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
+
+void report_placement(mem_engine_t engine, mem_placement_t policy, char *policy_name)
+{
+    // Throughput on the workload of test_random_blocks_multithread
+    int num_threads = 4;
+    int total_blocks = 8192;
+    size_t max_block_size = 1024;
+    pthread_t threads[num_threads];
+    thread_data_t thread_data[num_threads];
+    void **block_pointers = malloc(total_blocks * sizeof(void *));
+    my_assert(block_pointers != NULL);
+    mem_init_config(total_blocks * max_block_size, (mem_config_t){.engine = engine, .placement = policy});
+
+    struct timeval start_time, end_time;
+    gettimeofday(&start_time, NULL);
+    for (int i = 0; i < num_threads; i++)
+    {
+        thread_data[i].num_blocks = total_blocks / num_threads;
+        thread_data[i].max_block_size = max_block_size;
+        thread_data[i].block_pointers = &block_pointers[i * thread_data[i].num_blocks];
+        pthread_create(&threads[i], NULL, thread_alloc_free, &thread_data[i]);
+    }
+    for (int i = 0; i < num_threads; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    gettimeofday(&end_time, NULL);
+    mem_deinit();
+    free(block_pointers);
+    long random_micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+
+    // Churn: toggle random slots between a random-sized live block and nothing
+    int slots = 512;
+    size_t pool_size = 384 * 1024;
+    void *live[slots];
+    size_t live_size[slots];
+    size_t live_bytes = 0;
+    int failures = 0;
+    unsigned int seed = 42;
+    memset(live, 0, sizeof(live));
+    mem_init_config(pool_size, (mem_config_t){.engine = engine, .placement = policy});
+
+    gettimeofday(&start_time, NULL);
+    for (int i = 0; i < 200000; i++)
+    {
+        int slot = rand_r(&seed) % slots;
+        if (live[slot] != NULL)
+        {
+            mem_free(live[slot]);
+            live[slot] = NULL;
+            live_bytes -= live_size[slot];
+            continue;
+        }
+        live_size[slot] = 16 + rand_r(&seed) % 2048;
+        live[slot] = mem_alloc_uninit(live_size[slot]);
+        if (live[slot] == NULL)
+        {
+            failures++;
+            continue;
+        }
+        live_bytes += live_size[slot];
+    }
+    gettimeofday(&end_time, NULL);
+    long churn_micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+
+    size_t free_bytes = pool_size - live_bytes; // Block headers are counted as free space
+    size_t largest = largest_allocatable(free_bytes);
+    printf("    %-22s random blocks: %8ld us\tchurn: %8ld us\tfailed: %5d\tfree: %7zu\tlargest: %7zu\tfragmentation: %5.1f%%\n",
+           policy_name, random_micros, churn_micros, failures, free_bytes, largest,
+           free_bytes ? 100.0 * (1.0 - (double)largest / free_bytes) : 0.0);
+    mem_deinit();
+}
+
+void benchmark_placement()
+{
+    mem_placement_t policies[] = {MEM_FIT_SEGREGATED, MEM_FIT_FIRST, MEM_FIT_NEXT, MEM_FIT_BEST, MEM_FIT_ADDRESS_BEST};
+    char *policy_names[] = {"segregated fit", "first fit", "next fit", "best fit", "address-ordered best"};
+    char *engine_names[] = {"block list", "boundary tags"};
+
+    for (int e = 0; e < 2; e++)
+    {
+        printf_yellow("  Placement policies, %s engine:\n", engine_names[e]);
+        for (int p = 0; p < 5; p++)
+        {
+            report_placement((mem_engine_t)e, policies[p], policy_names[p]);
+        }
+    }
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Benchmark: resident size of a growable pool while the working set rises and falls.
+ */
+void benchmark_growable(size_t block_size)
+{
+    size_t phases_mb[] = {1, 4, 16, 64, 16, 4, 1, 0};
+    int max_blocks = 64 * 1024 * 1024 / block_size;
+    void **blocks = malloc(max_blocks * sizeof(void *));
+    my_assert(blocks != NULL);
+    int live = 0;
+
+    printf_yellow("  Working set of %zu-byte blocks in a pool growing from 64 KiB (watermarks 1 MiB / 256 KiB):\n", block_size);
+    mem_init_config(64 * 1024, (mem_config_t){.max_size = 256 * 1024 * 1024, .high_watermark = 1024 * 1024, .low_watermark = 256 * 1024});
+    for (int p = 0; p < 8; p++)
+    {
+        int target = phases_mb[p] * 1024 * 1024 / block_size;
+        struct timeval start_time, end_time;
+        gettimeofday(&start_time, NULL);
+        while (live < target)
+        {
+            blocks[live] = mem_alloc_uninit(block_size);
+            my_assert(blocks[live] != NULL);
+            live++;
+        }
+        while (live > target)
+        {
+            mem_free(blocks[--live]);
+        }
+        gettimeofday(&end_time, NULL);
+
+        long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+        printf("    live: %8zu KiB\tresident: %8zu KiB\ttime: %8ld microseconds\n",
+               live * block_size / 1024, mem_resident_size() / 1024, micros);
+    }
+    mem_deinit();
+    free(blocks);
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Benchmark: a burst of small objects released one by one on the block-list engine against a
+ * single mem_reset on a bump pool.
+ */
+void benchmark_bump_reset(int objects, size_t block_size)
+{
+    void **blocks = malloc(objects * sizeof(void *));
+    my_assert(blocks != NULL);
+    mem_engine_t engines[] = {MEM_ENGINE_BLOCK_LIST, MEM_ENGINE_BUMP};
+    char *names[] = {"block list + mem_free", "bump + mem_reset"};
+
+    printf_yellow("  Allocating and releasing %d blocks of %zu bytes, 10 rounds:\n", objects, block_size);
+    for (int e = 0; e < 2; e++)
+    {
+        mem_init_config(objects * block_size, (mem_config_t){.engine = engines[e]});
+        struct timeval start_time, end_time;
+        gettimeofday(&start_time, NULL);
+        for (int round = 0; round < 10; round++)
+        {
+            for (int i = 0; i < objects; i++)
+            {
+                blocks[i] = mem_alloc_uninit(block_size);
+                my_assert(blocks[i] != NULL);
+            }
+            if (engines[e] == MEM_ENGINE_BUMP)
+            {
+                mem_reset();
+                continue;
+            }
+            for (int i = 0; i < objects; i++)
+            {
+                mem_free(blocks[i]);
+            }
+        }
+        gettimeofday(&end_time, NULL);
+        mem_deinit();
+
+        long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+        printf("    %-24s time: %8ld microseconds\n", names[e], micros);
+    }
+    free(blocks);
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Benchmark: the allocate-fill-free loop of thread_function, one block at a time against
+ * mem_alloc_bulk and mem_free_bulk.
+ */
+typedef struct
+{
+    int num_blocks;
+    size_t block_size;
+    bool bulk;
+} bulk_thread_data_t;
+
+void *thread_bulk_blocks(void *arg)
+{
+    bulk_thread_data_t *params = (bulk_thread_data_t *)arg;
+    void **blocks = malloc(params->num_blocks * sizeof(void *));
+    my_assert(blocks != NULL);
+    for (int round = 0; round < 10; round++)
+    {
+        if (params->bulk)
+        {
+            my_assert(mem_alloc_bulk(params->block_size, params->num_blocks, blocks) == (size_t)params->num_blocks);
+            mem_free_bulk(blocks, params->num_blocks);
+            continue;
+        }
+        for (int i = 0; i < params->num_blocks; i++)
+        {
+            blocks[i] = mem_alloc(params->block_size);
+            my_assert(blocks[i] != NULL);
+        }
+        for (int i = 0; i < params->num_blocks; i++)
+            mem_free(blocks[i]);
+    }
+    free(blocks);
+    return NULL;
+}
+
+void benchmark_bulk(int num_threads, int num_blocks, size_t block_size)
+{
+    printf_yellow("  %d threads allocating and freeing %d blocks of %zu bytes, 10 rounds:\n", num_threads, num_blocks, block_size);
+    char *names[] = {"one at a time", "bulk"};
+    for (int bulk = 0; bulk < 2; bulk++)
+    {
+        mem_init((size_t)num_threads * num_blocks * block_size * 2);
+        pthread_t threads[num_threads];
+        bulk_thread_data_t params = {.num_blocks = num_blocks, .block_size = block_size, .bulk = bulk};
+        struct timeval start_time, end_time;
+        gettimeofday(&start_time, NULL);
+        for (int i = 0; i < num_threads; i++)
+            pthread_create(&threads[i], NULL, thread_bulk_blocks, &params);
+        for (int i = 0; i < num_threads; i++)
+            pthread_join(threads[i], NULL);
+        gettimeofday(&end_time, NULL);
+        mem_deinit();
+
+        long micros = (end_time.tv_sec - start_time.tv_sec) * 1000000 + (end_time.tv_usec - start_time.tv_usec);
+        printf("    %-14s time: %8ld microseconds\n", names[bulk], micros);
+    }
+    printf_green("  ... [DONE].\n");
+}
+
+/*
+ * Benchmark: latency distribution of single mem_alloc and mem_free calls per engine, on a
+ * pool kept half full by random sizes in random order.
+ */
+int compare_longs(const void *a, const void *b)
+{
+    long x = *(const long *)a, y = *(const long *)b;
+    return (x > y) - (x < y);
+}
+
+long elapsed_ns(struct timespec *start, struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1000000000L + (end->tv_nsec - start->tv_nsec);
+}
+
+void report_latency(char *label, long *samples, int count)
+{
+    qsort(samples, count, sizeof(long), compare_longs);
+    printf("      %-6s p50: %6ld ns\tp99: %6ld ns\tp99.9: %6ld ns\tmax: %8ld ns\n", label,
+           samples[count / 2], samples[count * 99 / 100], samples[count * 999 / 1000], samples[count - 1]);
+}
+
+void benchmark_engine_latency(int operations, int slots, size_t max_block_size)
+{
+    mem_engine_t engines[] = {MEM_ENGINE_BLOCK_LIST, MEM_ENGINE_BOUNDARY_TAG, MEM_ENGINE_BUDDY};
+    char *names[] = {"block list", "boundary tags", "buddy"};
+    void **blocks = calloc(slots, sizeof(void *));
+    long *alloc_ns = malloc(operations * sizeof(long));
+    long *free_ns = malloc(operations * sizeof(long));
+    my_assert(blocks != NULL && alloc_ns != NULL && free_ns != NULL);
+
+    printf_yellow("  %d random operations on %d slots of up to %zu bytes:\n", operations, slots, max_block_size);
+    for (int e = 0; e < 3; e++)
+    {
+        mem_init_config(slots * max_block_size, (mem_config_t){.engine = engines[e]});
+        srand(42);
+        int allocs = 0, frees = 0;
+        for (int i = 0; i < operations; i++)
+        {
+            int slot = rand() % slots;
+            struct timespec start_time, end_time;
+            if (blocks[slot] == NULL)
+            {
+                size_t size = 16 + rand() % (max_block_size - 16);
+                clock_gettime(CLOCK_MONOTONIC, &start_time);
+                blocks[slot] = mem_alloc_uninit(size);
+                clock_gettime(CLOCK_MONOTONIC, &end_time);
+                alloc_ns[allocs++] = elapsed_ns(&start_time, &end_time);
+            }
+            else
+            {
+                clock_gettime(CLOCK_MONOTONIC, &start_time);
+                mem_free(blocks[slot]);
+                clock_gettime(CLOCK_MONOTONIC, &end_time);
+                free_ns[frees++] = elapsed_ns(&start_time, &end_time);
+                blocks[slot] = NULL;
+            }
+        }
+        for (int i = 0; i < slots; i++)
+        {
+            mem_free(blocks[i]);
+            blocks[i] = NULL;
+        }
+        mem_deinit();
+
+        printf("    %s:\n", names[e]);
+        report_latency("alloc", alloc_ns, allocs);
+        report_latency("free", free_ns, frees);
+    }
+    free(blocks);
+    free(alloc_ns);
+    free(free_ns);
+    printf_green("  ... [DONE].\n");
+}
+
+void test_looking_for_out_of_bounds()
+{
+    printf("  Testing outofbounds (errors not tracked/detected here) \n");
+
+    printf("ALLOCATION 5000\n");
+    mem_init(5000); // Initialize with 1024 bytes
+    printf("ALLOCATED 5000\n");
+    void *block0 = mem_alloc(512); // Edge case: zero allocation
+    assert(block0 != NULL);        // Depending on handling, this could also be NULL
+
+    void *block1 = mem_alloc(512); // 0-1024
+    assert(block1 != NULL);
+
+    void *block2 = mem_alloc(1024); // 1024-2048
+    assert(block2 != NULL);
+
+    void *block3 = mem_alloc(2048); // 2048-4096
+    assert(block3 != NULL);
+
+    void *block4 = mem_alloc(904); // 4096-5000
+    assert(block4 != NULL);
+
+    printf("BLOCK0; %p, 512\n", block0);
+    printf("BLOCK1; %p, 512\n", block1);
+    printf("BLOCK2; %p, 1024\n", block2);
+    printf("BLOCK3; %p, 2048\n", block3);
+    printf("BLOCK4; %p, 904\n", block4);
+
+    mem_free(block0);
+    mem_free(block1);
+    mem_deinit();
+    printf("[PASS].\n");
+}
+
+int main(int argc, char *argv[])
+{
+#ifdef VERSION
+    printf("Build Version; %s \n", VERSION);
+#endif
+    printf("Git Version; %s/%s \n", git_date, git_sha);
+
+    if (argc < 2)
+    {
+        printf("Usage: %s <test function>\n", argv[0]);
+        printf("Available test functions:\n");
+
+        printf("  0. tests various functions with a base number of threads\n");
+        printf("  1. tests various functions across variious configurations (number of threads, memory sizes,  iterations)\n");
+        printf("  2. stress tests various functions with various configurations. This may take some time (especially if simulate_work flag is set to true.\n");
+        printf("  3. test_looking_for_out_of_bounds, needs LD_PRELOAD=./libmymalloc.so .\n");
+        printf("  4. benchmark mem_alloc/mem_free cost as the number of live blocks grows.\n");
+        printf("  5. benchmark small alloc/free pairs with and without thread caches.\n");
+        printf("  6. benchmark allocation throughput across arena counts.\n");
+        printf("  7. benchmark zeroing in the arena lock, mem_alloc and mem_alloc_uninit for callers that fill their blocks, with lock hold and wait times.\n");
+        printf("  8. report throughput and fragmentation of the placement policies.\n");
+        printf("  9. benchmark the resident size of a growable pool.\n");
+        printf("  10. benchmark releasing a burst of blocks with mem_free against mem_reset.\n");
+        printf("  11. compare mem_alloc/mem_free latency of the block-list, boundary-tag and buddy engines.\n");
+        printf("  12. benchmark mem_alloc_bulk/mem_free_bulk against allocating and freeing one block at a time.\n\n");
+        return 1;
+    }
+
+    // used for case 19
+    int base_num_threads = 4;
+    int allocs;
+    size_t blockSize;
+    bool simulate_work = false; // set this to true to see the benefits of multithreading
+
+    switch (atoi(argv[1]))
+    {
+    case -1:
+        printf("No tests will be executed.\n");
+        break;
+    case 0:
+        // Running all tests with a base number of threads
+        printf("\n*** Testing various functions with a base number of threads: ***\n");
+        if (exact_fit("mem_alloc and mem_free"))
+            run_concurrent_test(test_alloc_and_free, (TestParams){.num_threads = base_num_threads, .memory_size = 1024}, "mem_alloc and mem_free");
+        if (exact_fit("zero alloc and free"))
+            run_concurrent_test(test_zero_alloc_and_free, (TestParams){.num_threads = base_num_threads, .memory_size = 1024}, "zero alloc and free");
+
+        test_resize_multithread((TestParams){.num_threads = base_num_threads});
+
+        test_exceed_single_allocation_multithread((TestParams){.num_threads = base_num_threads});
+        test_exceed_cumulative_allocation_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 1024}); // TODO: Fix this to be able to run with various configurations
+
+        test_memory_overcommit_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 1024});
+
+        for (int i = 0; i < 4; i++)
+            test_repeated_fit_reuse_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 1024, .iterations = pow(10, i)});
+
+        test_memory_fragmentation_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 2048});
+        test_random_blocks_multithread((TestParams){.num_threads = base_num_threads, .block_size = 1024});
+        test_boundary_tag_engine();
+        test_resize_paths(MEM_ENGINE_BLOCK_LIST, "block list");
+        test_resize_paths(MEM_ENGINE_BOUNDARY_TAG, "boundary tags");
+        test_bulk_alloc_free(MEM_ENGINE_BLOCK_LIST, "block list");
+        test_bulk_alloc_free(MEM_ENGINE_BOUNDARY_TAG, "boundary tags");
+        test_stats();
+        test_fragmentation();
+        test_lock_profile();
+        test_ebr(base_num_threads);
+        test_tcache_multithread((TestParams){.num_threads = base_num_threads, .memory_size = 4096, .iterations = 1000});
+        test_tcache_double_free(MEM_ENGINE_BLOCK_LIST, "block list");
+        test_tcache_double_free(MEM_ENGINE_BOUNDARY_TAG, "boundary tags");
+        test_tcache_double_free(MEM_ENGINE_BUDDY, "buddy");
+        test_tcache_double_free_bulk(MEM_ENGINE_BLOCK_LIST, "block list");
+        test_tcache_double_free_bulk(MEM_ENGINE_BOUNDARY_TAG, "boundary tags");
+        test_tcache_double_free_bulk(MEM_ENGINE_BUDDY, "buddy");
+        test_arenas_multithread((TestParams){.num_threads = base_num_threads * 2, .memory_size = 4096, .block_size = 64});
+        if (exact_fit("slab"))
+            test_slab_multithread((TestParams){.num_threads = base_num_threads, .block_size = 48, .iterations = 10000});
+        test_calloc_and_uninit();
+        test_aligned_alloc(MEM_ENGINE_BLOCK_LIST);
+        test_aligned_alloc(MEM_ENGINE_BOUNDARY_TAG);
+        test_placement_policies(MEM_ENGINE_BLOCK_LIST);
+        test_placement_policies(MEM_ENGINE_BOUNDARY_TAG);
+        test_growable_pool(MEM_ENGINE_BLOCK_LIST);
+        test_growable_pool(MEM_ENGINE_BOUNDARY_TAG);
+        test_bump_pool();
+        test_buddy_engine();
+        test_pool_handles((TestParams){.num_threads = base_num_threads, .memory_size = 1024, .block_size = 64, .iterations = 1000});
+
+        break;
+
+    case 1:
+        printf("\n*** Testing various functions across variious configurations (number of threads, memory sizes,  iterations): ***\n");
+        testAcrossConfigurations(test_resize_multithread, (TestParams){.memory_size = 1024});
+        testAcrossConfigurations(test_exceed_single_allocation_multithread, (TestParams){.memory_size = 1024});
+
+        for (int i = 1; i < 6; i++)
+            test_exceed_cumulative_allocation_multithread((TestParams){.num_threads = pow(2, i), .memory_size = pow(2, 11 + i)});
+        break;
+        testAcrossConfigurations(test_memory_overcommit_multithread, (TestParams){.memory_size = 1024});
+        testAcrossConfigurations(test_repeated_fit_reuse_multithread, (TestParams){.iterations = 1});
+        testAcrossConfigurations(test_memory_fragmentation_multithread, (TestParams){.iterations = 1});
+        testAcrossConfigurations(test_random_blocks_multithread, (TestParams){.memory_size = 1024, .block_size = 1024});
+
+        break;
+    case 2:
+        printf("\n*** Scalability testing: ***\n");
+
+        printf("Testing mem_alloc and mem_free\n");
+
+        for (int i = 1; i < 4; i++)
+        {
+            for (int j = 1; j < 5; j++)
+            {
+                run_concurrent_test(test_alloc_and_free, (TestParams){.num_threads = i, .memory_size = pow(2, 9 + j)}, "mem_alloc and mem_free");
+            }
+        }
+
+        printf("Testing random blocks\n");
+        for (int i = 2; i < 6; i++)
+        {
+            test_random_blocks_multithread((TestParams){.num_threads = pow(2, i), .block_size = 1024});
+        }
+
+        allocs = (int)pow(2, 15);
+        blockSize = (int)pow(2, 7);
+        // run_concurrency_test(1, 3, 100);
+
+        printf("Testing large number of blocks of fixed size\n");
+        for (int i = 0; i < 9; i++)
+            run_concurrency_test((TestParams){.num_threads = pow(2, i), .num_blocks = allocs, .block_size = blockSize, .simulate_work = simulate_work});
+        break;
+
+    case 3:
+        printf("Test 3.\n");
+        test_looking_for_out_of_bounds();
+        break;
+
+    case 4:
+        printf("\n*** Allocation scaling benchmark: ***\n");
+        benchmark_alloc_scaling(128, 8192, (mem_config_t){.engine = MEM_ENGINE_BLOCK_LIST}, "block list");
+        benchmark_alloc_scaling(128, 8192, (mem_config_t){.engine = MEM_ENGINE_BOUNDARY_TAG}, "boundary tags");
+        benchmark_alloc_scaling(128, 8192, (mem_config_t){.engine = MEM_ENGINE_BUDDY}, "buddy");
+        break;
+
+    case 5:
+        printf("\n*** Thread cache benchmark: ***\n");
+        benchmark_tcache((int)pow(2, 20));
+        break;
+
+    case 6:
+        printf("\n*** Arena benchmark: ***\n");
+        benchmark_arenas((int)pow(2, 15), 128);
+        break;
+
+    case 7:
+        printf("\n*** Uninitialized allocation benchmark: ***\n");
+        benchmark_uninit((int)pow(2, 18), 4096);
+        break;
+
+    case 8:
+        printf("\n*** Placement policy report: ***\n");
+        benchmark_placement();
+        break;
+
+    case 9:
+        printf("\n*** Growable pool benchmark: ***\n");
+        benchmark_growable(4096);
+        break;
+
+    case 10:
+        printf("\n*** Bump pool reset benchmark: ***\n");
+        benchmark_bump_reset(1 << 16, 64);
+        break;
+
+    case 11:
+        printf("\n*** Engine latency benchmark: ***\n");
+        benchmark_engine_latency(1 << 20, 4096, 512);
+        break;
+
+    case 12:
+        printf("\n*** Bulk allocation benchmark: ***\n");
+        benchmark_bulk(1, 4096, 64);
+        benchmark_bulk(8, 4096, 64);
         break;
 
     default:
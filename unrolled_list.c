@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include "memory_manager.h"
+#include "unrolled_list.h"
+
+// Every node but the tail keeps at least ULIST_HALF values: a split leaves two halves, a delete
+// that drops a node below it merges the node with its successor or borrows from it. The list
+// therefore never needs more than capacity / ULIST_HALF nodes, plus the tail and one node split
+// off it.
+#define ULIST_HALF (ULIST_NODE_VALUES / 2)
+
+static UNode* unode_alloc(ulist_t* list) {
+    UNode* node = (UNode*)mem_slab_alloc(list->node_slab);
+    if (node == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    node->count = 0;
+    node->next = NULL;
+    list->nodes++;
+    return node;
+}
+
+static void unode_free(ulist_t* list, UNode* node) {
+    mem_slab_free(list->node_slab, node);
+    list->nodes--;
+}
+
+// Search kernels: index of the first occurrence of data in node, -1 if there is none
+typedef int (*unode_find_fn)(const UNode* node, uint16_t data);
+
+static int unode_find_scalar(const UNode* node, uint16_t data) {
+    for (int i = 0; i < node->count; i++) {
+        if (node->values[i] == data) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define ULIST_X86
+
+// A node is one cache line with the values at its start, so the vector kernels compare whole
+// 16 or 32 byte slices of it. Lanes at and past count, which hold stale values, the count and
+// the next pointer, are masked off. movemask yields two bits per 16-bit lane.
+__attribute__((target("sse2")))
+static int unode_find_sse2(const UNode* node, uint16_t data) {
+    __m128i key = _mm_set1_epi16((short)data);
+    const __m128i* line = (const __m128i*)node;
+    for (int i = 0; i * 8 < node->count; i++) {
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128(line + i), key));
+        if (mask) {
+            int index = i * 8 + __builtin_ctz(mask) / 2;
+            return index < node->count ? index : -1; // Later slices only hold lanes past count
+        }
+    }
+    return -1;
+}
+
+__attribute__((target("avx2")))
+static int unode_find_avx2(const UNode* node, uint16_t data) {
+    __m256i key = _mm256_set1_epi16((short)data);
+    const __m256i* line = (const __m256i*)node;
+    uint64_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_loadu_si256(line), key));
+    if (node->count > 16) {
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_loadu_si256(line + 1), key)) << 32;
+    }
+    mask &= (1ULL << (2 * node->count)) - 1;
+    return mask ? __builtin_ctzll(mask) / 2 : -1;
+}
+#endif
+
+_Static_assert(sizeof(UNode) == MEM_CACHE_LINE, "the search kernels read whole nodes");
+
+static unode_find_fn find_kernel = unode_find_scalar;
+static pthread_once_t find_kernel_once = PTHREAD_ONCE_INIT;
+
+static ulist_search_t find_kernel_set(ulist_search_t kernel) {
+    unode_find_fn find = unode_find_scalar;
+    ulist_search_t kind = ULIST_SEARCH_SCALAR;
+#ifdef ULIST_X86
+    __builtin_cpu_init();
+    if ((kernel == ULIST_SEARCH_AUTO || kernel == ULIST_SEARCH_AVX2) && __builtin_cpu_supports("avx2")) {
+        find = unode_find_avx2;
+        kind = ULIST_SEARCH_AVX2;
+    } else if (kernel != ULIST_SEARCH_SCALAR && __builtin_cpu_supports("sse2")) {
+        find = unode_find_sse2;
+        kind = ULIST_SEARCH_SSE2;
+    }
+#endif
+    __atomic_store_n(&find_kernel, find, __ATOMIC_RELAXED);
+    return kind;
+}
+
+static void find_kernel_select(void) {
+    find_kernel_set(ULIST_SEARCH_AUTO);
+}
+
+ulist_search_t ulist_use_search(ulist_search_t kernel) {
+    pthread_once(&find_kernel_once, find_kernel_select); // So the first ulist_create keeps this choice
+    return find_kernel_set(kernel);
+}
+
+// Finds the first occurrence of data, its node's predecessor goes to *prev. Returns the node or
+// NULL, the value's index in the node goes to *index.
+static UNode* ulist_find(ulist_t* list, uint16_t data, UNode** prev, int* index) {
+    unode_find_fn find = __atomic_load_n(&find_kernel, __ATOMIC_RELAXED);
+    UNode* before = NULL;
+    for (UNode* node = list->head; node != NULL; before = node, node = node->next) {
+        int i = find(node, data);
+        if (i >= 0) {
+            if (prev) {
+                *prev = before;
+            }
+            *index = i;
+            return node;
+        }
+    }
+    return NULL;
+}
+
+ulist_t* ulist_create(size_t capacity) {
+    pthread_once(&find_kernel_once, find_kernel_select);
+    ulist_t* list = malloc(sizeof(ulist_t));
+    if (list == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    size_t max_nodes = capacity / ULIST_HALF + 2;
+    // Nodes are cache-line aligned, so a node's values never straddle two lines
+    list->pool = mem_pool_create_config(max_nodes * sizeof(UNode) + MEM_CACHE_LINE,
+                                        (mem_config_t){.engine = MEM_ENGINE_BUMP, .alignment = MEM_CACHE_LINE});
+    list->node_slab = mem_pool_slab_create(list->pool, sizeof(UNode), max_nodes);
+    if (list->node_slab == NULL) {
+        fprintf(stderr, "Memory allocation failed\n");
+        exit(EXIT_FAILURE);
+    }
+    list->head = NULL;
+    list->tail = NULL;
+    list->count = 0;
+    list->nodes = 0;
+    pthread_rwlock_init(&list->lock, NULL);
+    return list;
+}
+
+void ulist_destroy(ulist_t* list) {
+    if (list == NULL) {
+        return;
+    }
+    pthread_rwlock_destroy(&list->lock);
+    mem_slab_destroy(list->node_slab);
+    mem_pool_destroy(list->pool);
+    free(list);
+}
+
+// Inserts data at values[index] of node, splitting the node first if it is full
+static void ulist_insert_at(ulist_t* list, UNode* node, int index, uint16_t data) {
+    if (node->count == ULIST_NODE_VALUES) {
+        UNode* half = unode_alloc(list);
+        half->count = ULIST_NODE_VALUES - ULIST_HALF;
+        memcpy(half->values, node->values + ULIST_HALF, half->count * sizeof(uint16_t));
+        node->count = ULIST_HALF;
+        half->next = node->next;
+        node->next = half;
+        if (list->tail == node) {
+            list->tail = half;
+        }
+        if (index > node->count) {
+            index -= node->count;
+            node = half;
+        }
+    }
+    memmove(node->values + index + 1, node->values + index, (node->count - index) * sizeof(uint16_t));
+    node->values[index] = data;
+    node->count++;
+    list->count++;
+}
+
+void ulist_insert(ulist_t* list, uint16_t data) {
+    pthread_rwlock_wrlock(&list->lock);
+    // Appends fill the tail up instead of splitting it, sequential inserts leave full nodes
+    if (list->tail == NULL || list->tail->count == ULIST_NODE_VALUES) {
+        UNode* node = unode_alloc(list);
+        if (list->tail == NULL) {
+            list->head = node;
+        } else {
+            list->tail->next = node;
+        }
+        list->tail = node;
+    }
+    list->tail->values[list->tail->count++] = data;
+    list->count++;
+    pthread_rwlock_unlock(&list->lock);
+}
+
+bool ulist_insert_after(ulist_t* list, uint16_t after, uint16_t data) {
+    pthread_rwlock_wrlock(&list->lock);
+    int index;
+    UNode* node = ulist_find(list, after, NULL, &index);
+    if (node) {
+        ulist_insert_at(list, node, index + 1, data);
+    }
+    pthread_rwlock_unlock(&list->lock);
+    return node != NULL;
+}
+
+bool ulist_insert_before(ulist_t* list, uint16_t before, uint16_t data) {
+    pthread_rwlock_wrlock(&list->lock);
+    int index;
+    UNode* node = ulist_find(list, before, NULL, &index);
+    if (node) {
+        ulist_insert_at(list, node, index, data);
+    }
+    pthread_rwlock_unlock(&list->lock);
+    return node != NULL;
+}
+
+// Restores the node invariant after a delete from node, prev is its predecessor
+static void ulist_rebalance(ulist_t* list, UNode* prev, UNode* node) {
+    if (node->count == 0) {
+        // Only the tail, or a head without successor, can run empty
+        if (prev) {
+            prev->next = node->next;
+        } else {
+            list->head = node->next;
+        }
+        if (list->tail == node) {
+            list->tail = prev;
+        }
+        unode_free(list, node);
+        return;
+    }
+    UNode* next = node->next;
+    if (node->count >= ULIST_HALF || next == NULL) {
+        return;
+    }
+    if (node->count + next->count <= ULIST_NODE_VALUES) {
+        memcpy(node->values + node->count, next->values, next->count * sizeof(uint16_t));
+        node->count += next->count;
+        node->next = next->next;
+        if (list->tail == next) {
+            list->tail = node;
+        }
+        unode_free(list, next);
+    } else {
+        // next holds more than it can give away and stay half full, take the difference's half
+        int moved = (next->count - node->count) / 2;
+        memcpy(node->values + node->count, next->values, moved * sizeof(uint16_t));
+        node->count += moved;
+        next->count -= moved;
+        memmove(next->values, next->values + moved, next->count * sizeof(uint16_t));
+    }
+}
+
+bool ulist_delete(ulist_t* list, uint16_t data) {
+    pthread_rwlock_wrlock(&list->lock);
+    UNode* prev;
+    int index;
+    UNode* node = ulist_find(list, data, &prev, &index);
+    if (node) {
+        node->count--;
+        memmove(node->values + index, node->values + index + 1, (node->count - index) * sizeof(uint16_t));
+        list->count--;
+        ulist_rebalance(list, prev, node);
+    }
+    pthread_rwlock_unlock(&list->lock);
+    return node != NULL;
+}
+
+long ulist_search(ulist_t* list, uint16_t data) {
+    unode_find_fn find = __atomic_load_n(&find_kernel, __ATOMIC_RELAXED);
+    pthread_rwlock_rdlock(&list->lock);
+    long position = -1;
+    long offset = 0;
+    for (UNode* node = list->head; node != NULL; node = node->next) {
+        int i = find(node, data);
+        if (i >= 0) {
+            position = offset + i;
+            break;
+        }
+        offset += node->count;
+    }
+    pthread_rwlock_unlock(&list->lock);
+    return position;
+}
+
+size_t ulist_count(ulist_t* list) {
+    pthread_rwlock_rdlock(&list->lock);
+    size_t count = list->count;
+    pthread_rwlock_unlock(&list->lock);
+    return count;
+}
+
+size_t ulist_node_count(ulist_t* list) {
+    pthread_rwlock_rdlock(&list->lock);
+    size_t nodes = list->nodes;
+    pthread_rwlock_unlock(&list->lock);
+    return nodes;
+}
+
+void ulist_display(ulist_t* list) {
+    pthread_rwlock_rdlock(&list->lock);
+    printf("[");
+    const char* separator = "";
+    for (UNode* node = list->head; node != NULL; node = node->next) {
+        for (int i = 0; i < node->count; i++) {
+            printf("%s%d", separator, node->values[i]);
+            separator = ", ";
+        }
+    }
+    printf("]\n");
+    pthread_rwlock_unlock(&list->lock);
+}
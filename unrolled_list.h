@@ -0,0 +1,55 @@
+// unrolled_list.h
+#ifndef UNROLLED_LIST_H
+#define UNROLLED_LIST_H
+
+#include "memory_manager.h"
+#include <stdint.h> // For uint16_t
+#include <stdbool.h>
+#include <pthread.h>
+
+// Values per node: the values, their count and the next pointer fill one cache line
+#define ULIST_NODE_VALUES ((MEM_CACHE_LINE - sizeof(void *) - sizeof(uint16_t)) / sizeof(uint16_t))
+
+typedef struct UNode
+{
+    uint16_t values[ULIST_NODE_VALUES]; // First so they start on the cache line
+    uint16_t count;                     // Values in use, values[0 .. count - 1]
+    struct UNode *next;
+} UNode;
+
+// Unrolled linked list of uint16_t values. Nodes are cache-line sized arrays that split when an
+// insert finds them full and merge with their successor when a delete leaves them less than half
+// full. Positions are given by value: the first occurrence of a value in list order.
+typedef struct ulist
+{
+    UNode *head;
+    UNode *tail;
+    size_t count;            // Values in the list
+    size_t nodes;            // Nodes in the list
+    pthread_rwlock_t lock;   // Readers share it, every change takes it exclusively
+    mem_pool_t *pool;
+    mem_slab_t *node_slab;
+} ulist_t;
+
+// Kernels ulist_search and the value lookups of the other operations compare a node's values with
+typedef enum {
+    ULIST_SEARCH_AUTO = 0, // The widest one the CPU supports (default)
+    ULIST_SEARCH_SCALAR,   // One value at a time
+    ULIST_SEARCH_SSE2,     // 8 values per compare
+    ULIST_SEARCH_AVX2,     // 16 values per compare, a node in two
+} ulist_search_t;
+
+ulist_search_t ulist_use_search(ulist_search_t kernel); // For every list, returns the kernel in use: the next narrower one if the CPU lacks it
+
+ulist_t *ulist_create(size_t capacity); // Room for at least capacity values
+void ulist_destroy(ulist_t *list);
+void ulist_insert(ulist_t *list, uint16_t data);                    // Appends
+bool ulist_insert_after(ulist_t *list, uint16_t after, uint16_t data); // False if after is not in the list
+bool ulist_insert_before(ulist_t *list, uint16_t before, uint16_t data);
+bool ulist_delete(ulist_t *list, uint16_t data);                    // Deletes the first occurrence
+long ulist_search(ulist_t *list, uint16_t data);                    // Index of the first occurrence, -1 if none
+size_t ulist_count(ulist_t *list);
+size_t ulist_node_count(ulist_t *list);
+void ulist_display(ulist_t *list);
+
+#endif // UNROLLED_LIST_H